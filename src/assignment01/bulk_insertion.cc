@@ -0,0 +1,128 @@
+#include "bulk_insertion.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include <typed-geometry/tg.hh>
+
+#include <common/predicates.hh>
+
+#include "point_location.hh"
+#include "task.hh"
+
+namespace
+{
+constexpr int hilbert_bits = 16;
+
+// rounds smaller than this are merged into the first round
+constexpr int min_round_size = 64;
+
+// index along the Hilbert curve of order hilbert_bits
+std::uint32_t hilbert_index(std::uint32_t x, std::uint32_t y)
+{
+    constexpr std::uint32_t n = 1u << hilbert_bits;
+    std::uint32_t d = 0;
+    for (auto s = n / 2; s > 0; s /= 2)
+    {
+        auto const rx = (x & s) > 0 ? 1u : 0u;
+        auto const ry = (y & s) > 0 ? 1u : 0u;
+        d += s * s * ((3 * rx) ^ ry);
+
+        // rotate the quadrant so that the sub-curve starts and ends at the right corners
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+}
+
+std::vector<pm::vertex_index> gp::insert_vertices(pm::Mesh& mesh, pm::vertex_attribute<tg::pos2>& position, pm::span<tg::pos2 const> points)
+{
+    auto const n = int(points.size());
+    std::vector<pm::vertex_index> vertices(n);
+    if (n == 0)
+        return vertices;
+
+    // hilbert keys relative to the bounding box of the points
+    auto bounds = tg::aabb2(points[0], points[0]);
+    for (auto const& p : points)
+        bounds = tg::aabb_of(bounds, p);
+
+    auto const scale = float((1u << hilbert_bits) - 1) / tg::max(tg::max_element(bounds.max - bounds.min), 1e-30f);
+    std::vector<std::uint32_t> keys(n);
+    for (auto i = 0; i < n; ++i)
+    {
+        auto const q = (points[i] - bounds.min) * scale;
+        keys[i] = hilbert_index(std::uint32_t(q.x), std::uint32_t(q.y));
+    }
+
+    // biased randomized insertion order: random permutation, the last round is the second half, the one before the
+    // second quarter and so on, the points within a round follow the curve
+    std::vector<int> order(n);
+    for (auto i = 0; i < n; ++i)
+        order[i] = i;
+
+    tg::rng rng;
+    for (auto i = n - 1; i > 0; --i)
+        std::swap(order[i], order[tg::uniform(rng, 0, i)]);
+
+    std::vector<std::pair<int, int>> rounds;
+    auto end = n;
+    while (end > min_round_size)
+    {
+        rounds.emplace_back(end / 2, end);
+        end /= 2;
+    }
+    rounds.emplace_back(0, end);
+    std::reverse(rounds.begin(), rounds.end());
+
+    for (auto r = 0u; r < rounds.size(); ++r)
+    {
+        auto const first = order.begin() + rounds[r].first;
+        auto const last = order.begin() + rounds[r].second;
+
+        // alternating directions, so each round starts near where the previous one ended
+        if (r % 2 == 0)
+            std::sort(first, last, [&](int a, int b) { return keys[a] < keys[b]; });
+        else
+            std::sort(first, last, [&](int a, int b) { return keys[a] > keys[b]; });
+    }
+
+    // consecutive points are close, so the hint is almost always better than sampling
+    point_locator locator(position, 1);
+    for (auto const i : order)
+    {
+        auto const& p = points[i];
+        auto const face = locator.locate(p);
+        if (face.is_invalid() || face.vertices().any([&](pm::vertex_handle v) { return position[v] == p; }))
+            continue;
+
+        vertices[i] = task::insert_vertex(mesh, position, p, face);
+        auto const v = mesh.vertices()[vertices[i]];
+
+        // a point exactly on the boundary leaves a zero-area face on the old boundary edge (boundary edges are never
+        // flipped), removing that edge (and the face) makes the point a boundary vertex between its two endpoints
+        for (auto const h : v.outgoing_halfedges())
+        {
+            auto const opposite = h.next();
+            if (opposite.face().is_valid() && opposite.edge().is_boundary()
+                && gp::orient2d(position[opposite.vertex_from()], position[opposite.vertex_to()], p) == 0)
+            {
+                mesh.edges().remove(opposite.edge());
+                break;
+            }
+        }
+
+        locator.set_hint(v.any_valid_face());
+    }
+
+    return vertices;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <polymesh/span.hh>
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+/// inserts many points into a Delaunay triangulation (counter-clockwise faces, convex boundary) via task::insert_vertex
+/// the points are inserted in a Biased Randomized Insertion Order (Amenta, Choi, Rote): the points are shuffled and
+/// split into rounds of doubling size, each round is sorted along a Hilbert curve (reversed every other round), and
+/// every point location starts at a face of the previously inserted vertex
+/// this keeps the expected walk length constant while preserving the randomized worst-case bounds
+/// points exactly on the boundary split their boundary edge, so they become boundary vertices without a zero-area face
+/// returns the vertex of every point in input order, invalid for points outside of the triangulation and duplicates
+std::vector<pm::vertex_index> insert_vertices(pm::Mesh& mesh, pm::vertex_attribute<tg::pos2>& position, pm::span<tg::pos2 const> points);
+}
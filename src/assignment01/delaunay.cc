@@ -0,0 +1,514 @@
+#include "delaunay.hh"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include <polymesh/algorithms/delaunay.hh>
+#include <polymesh/properties.hh>
+
+#include <typed-geometry/tg.hh>
+
+#include <common/predicates.hh>
+#include <common/thread_pool.hh>
+#include <common/trace.hh>
+
+#include "point_location.hh"
+#include "task.hh"
+
+namespace
+{
+// below this, a strip costs more in setup and stitching than it saves
+constexpr int min_points_per_strip = 1 << 14;
+
+struct strip
+{
+    pm::Mesh mesh;
+    pm::vertex_attribute<tg::pos2> position = mesh.vertices().make_attribute<tg::pos2>();
+    std::vector<int> vertices; ///< vertex of the full mesh for every strip vertex
+    bool ok = false;
+};
+
+// neighbors of a vertex on the convex boundary of a triangulation with counter-clockwise faces
+// (boundary halfedges run clockwise around the hull)
+pm::vertex_handle boundary_cw(pm::vertex_handle v)
+{
+    for (auto const h : v.outgoing_halfedges())
+        if (h.is_boundary())
+            return h.vertex_to();
+    return {};
+}
+pm::vertex_handle boundary_ccw(pm::vertex_handle v)
+{
+    for (auto const h : v.incoming_halfedges())
+        if (h.is_boundary())
+            return h.vertex_from();
+    return {};
+}
+
+// triangulates the gap between the convex triangulation left of a vertical line and the one right of it,
+// appends the edges of the new faces to seam
+void stitch(pm::Mesh& m,
+            pm::vertex_attribute<tg::pos2> const& position,
+            pm::vertex_handle rightmost,
+            pm::vertex_handle leftmost,
+            std::vector<pm::edge_index>& seam)
+{
+    // lower common tangent (a, b): walk down both hulls while the next vertex lies below the line a -> b
+    auto a = rightmost;
+    auto b = leftmost;
+    for (auto moved = true; moved;)
+    {
+        moved = false;
+        if (auto const next = boundary_cw(a); gp::orient2d(position[a], position[b], position[next]) < 0)
+        {
+            a = next;
+            moved = true;
+        }
+        else if (auto const next = boundary_ccw(b); gp::orient2d(position[a], position[b], position[next]) < 0)
+        {
+            b = next;
+            moved = true;
+        }
+    }
+
+    // upper common tangent, same but upwards
+    auto upper_a = rightmost;
+    auto upper_b = leftmost;
+    for (auto moved = true; moved;)
+    {
+        moved = false;
+        if (auto const next = boundary_ccw(upper_a); gp::orient2d(position[upper_a], position[upper_b], position[next]) > 0)
+        {
+            upper_a = next;
+            moved = true;
+        }
+        else if (auto const next = boundary_cw(upper_b); gp::orient2d(position[upper_a], position[upper_b], position[next]) > 0)
+        {
+            upper_b = next;
+            moved = true;
+        }
+    }
+
+    // the hull chains facing each other, bottom to top
+    // they always contain the extreme vertex, so if both tangents touch a hull in the same vertex, the chain is
+    // either just that vertex or the whole hull (a triangulation hidden behind a single vertex, which is visited twice)
+    // (collected before adding faces, the zipper temporarily creates vertices with two boundary gaps)
+    std::vector<pm::vertex_handle> chain_a = {a};
+    for (auto passed = a == rightmost; chain_a.back() != upper_a || !passed;)
+    {
+        chain_a.push_back(boundary_ccw(chain_a.back()));
+        passed = passed || chain_a.back() == rightmost;
+    }
+    std::vector<pm::vertex_handle> chain_b = {b};
+    for (auto passed = b == leftmost; chain_b.back() != upper_b || !passed;)
+    {
+        chain_b.push_back(boundary_cw(chain_b.back()));
+        passed = passed || chain_b.back() == leftmost;
+    }
+
+    // zipper from the lower to the upper tangent: the region above the current base edge (va, vb) is a polygon
+    // bounded by the two chains, the next face clips the ear at va (apex on chain a) or at vb (apex on chain b)
+    // an ear is valid if it is counter-clockwise and does not contain the next vertex of the other chain,
+    // if both are valid, the Delaunay one is taken
+    auto const in_closed_triangle = [](tg::pos2 p0, tg::pos2 p1, tg::pos2 p2, tg::pos2 p) {
+        return gp::orient2d(p0, p1, p) >= 0 && gp::orient2d(p1, p2, p) >= 0 && gp::orient2d(p2, p0, p) >= 0;
+    };
+    auto i = 0u;
+    auto j = 0u;
+    while (i + 1 < chain_a.size() || j + 1 < chain_b.size())
+    {
+        auto const va = chain_a[i];
+        auto const vb = chain_b[j];
+
+        bool advance_a;
+        if (i + 1 == chain_a.size())
+            advance_a = false;
+        else if (j + 1 == chain_b.size())
+            advance_a = true;
+        else
+        {
+            auto const pa = position[va];
+            auto const pb = position[vb];
+            auto const pa_next = position[chain_a[i + 1]];
+            auto const pb_next = position[chain_b[j + 1]];
+            auto const a_valid = gp::orient2d(pa, pb, pa_next) > 0 && !in_closed_triangle(pa, pb, pa_next, pb_next);
+            auto const b_valid = gp::orient2d(pa, pb, pb_next) > 0 && !in_closed_triangle(pa, pb, pb_next, pa_next);
+            advance_a = a_valid && b_valid ? gp::incircle(pa, pb, pa_next, pb_next) <= 0 : a_valid;
+        }
+
+        auto const f = advance_a ? m.faces().add(va, vb, chain_a[++i]) : m.faces().add(va, vb, chain_b[++j]);
+        for (auto const e : f.edges())
+            seam.push_back(e);
+    }
+}
+
+// neighbors of v in counter-clockwise order, for a boundary vertex from its ccw to its cw hull neighbor
+// (the faces around v are (v, link[i], link[i + 1]), and (v, link.back(), link.front()) if closed)
+std::vector<pm::vertex_handle> link_of(pm::vertex_handle v, bool& closed)
+{
+    pm::halfedge_handle boundary;
+    for (auto const h : v.outgoing_halfedges())
+        if (h.is_boundary())
+            boundary = h;
+
+    std::vector<pm::vertex_handle> link;
+    auto const start = boundary.is_valid() ? boundary.prev().opposite() : v.any_outgoing_halfedge();
+    auto h = start;
+    do
+    {
+        link.push_back(h.vertex_to());
+        h = h.prev().opposite();
+    } while (h != start && h != boundary);
+
+    closed = boundary.is_invalid();
+    if (!closed)
+        link.push_back(boundary.vertex_to());
+    return link;
+}
+
+// edges whose Delaunay test depends on the position of v: its spokes and the edges opposite of it
+void add_star_edges(pm::vertex_handle v, std::vector<pm::edge_index>& edges)
+{
+    for (auto const h : v.outgoing_halfedges())
+    {
+        edges.push_back(h.edge());
+        if (!h.is_boundary())
+            edges.push_back(h.next().edge());
+    }
+}
+
+// triangulates the hole bounded by the link of a removed vertex (counter-clockwise, left of the chain)
+// ear by ear, preferring ears whose circumcircle contains no other link vertex (those are Delaunay)
+// an open chain (removed boundary vertex) is filled until it is convex, i.e. part of the new hull
+// appends the edges of the new faces to edges
+void fill_link(pm::Mesh& m,
+               pm::vertex_attribute<tg::pos2> const& position,
+               std::vector<pm::vertex_handle> chain,
+               bool closed,
+               std::vector<pm::edge_index>& edges)
+{
+    auto const in_closed_triangle = [](tg::pos2 p0, tg::pos2 p1, tg::pos2 p2, tg::pos2 p) {
+        return gp::orient2d(p0, p1, p) >= 0 && gp::orient2d(p1, p2, p) >= 0 && gp::orient2d(p2, p0, p) >= 0;
+    };
+
+    while (chain.size() >= 3)
+    {
+        auto const n = int(chain.size());
+        auto const first = closed ? 0 : 1;
+        auto const last = closed ? n : n - 1;
+
+        // Delaunay ear if there is one, otherwise any ear that does not contain another link vertex
+        auto ear = -1;
+        auto fallback = -1;
+        for (auto i = first; i < last && ear < 0; ++i)
+        {
+            auto const pa = position[chain[(i + n - 1) % n]];
+            auto const pb = position[chain[i]];
+            auto const pc = position[chain[(i + 1) % n]];
+            if (gp::orient2d(pa, pb, pc) <= 0)
+                continue;
+
+            auto empty_circle = true;
+            auto empty_triangle = true;
+            for (auto j = 0; j < n; ++j)
+            {
+                if (j == i || j == (i + n - 1) % n || j == (i + 1) % n)
+                    continue;
+                auto const p = position[chain[j]];
+                empty_circle = empty_circle && gp::incircle(pa, pb, pc, p) <= 0;
+                empty_triangle = empty_triangle && !in_closed_triangle(pa, pb, pc, p);
+            }
+
+            if (empty_circle)
+                ear = i;
+            else if (empty_triangle && fallback < 0)
+                fallback = i;
+        }
+
+        if (ear < 0)
+            ear = fallback;
+        if (ear < 0)
+            break; // open chain is convex (or the closed one is degenerate)
+
+        auto const f = m.faces().add(chain[(ear + n - 1) % n], chain[ear], chain[(ear + 1) % n]);
+        for (auto const e : f.edges())
+            edges.push_back(e);
+        chain.erase(chain.begin() + ear);
+    }
+}
+}
+
+int gp::make_delaunay(pm::Mesh& m, pm::vertex_attribute<tg::pos2> const& position)
+{
+    std::vector<pm::edge_index> queue;
+    for (auto e : m.edges())
+        queue.push_back(e);
+
+    return make_delaunay(m, position, std::move(queue));
+}
+
+int gp::make_delaunay(pm::Mesh& m, pm::vertex_attribute<tg::pos2> const& position, std::vector<pm::edge_index> queue)
+{
+    auto flips = 0;
+
+    while (!queue.empty())
+    {
+        auto e = queue.back().of(m);
+        queue.pop_back();
+
+        if (e.is_removed() || e.is_boundary())
+            continue;
+
+        if (task::is_delaunay(e, position))
+            continue;
+
+        if (pm::valence(e.vertexA()) <= 2 || pm::valence(e.vertexB()) <= 2)
+            continue;
+
+        queue.push_back(e.halfedgeA().next().edge());
+        queue.push_back(e.halfedgeA().prev().edge());
+        queue.push_back(e.halfedgeB().next().edge());
+        queue.push_back(e.halfedgeB().prev().edge());
+
+        m.edges().flip(e);
+        ++flips;
+    }
+
+    return flips;
+}
+
+bool gp::create_delaunay_triangulation(pm::Mesh& m, pm::vertex_attribute<tg::pos2> const& position, int num_strips)
+{
+    auto& pool = thread_pool::global();
+    auto const n = m.vertices().size();
+
+    if (num_strips <= 0)
+        num_strips = tg::min(pool.num_threads(), n / min_points_per_strip);
+    num_strips = tg::max(1, tg::min(num_strips, n / 3));
+
+    // strips of equal size in lexicographic (x, y) order, a strip boundary never separates points with the same x,
+    // so neighboring strips are separated by a vertical line
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int i, int j) {
+        auto const& pi = position[pm::vertex_index(i)];
+        auto const& pj = position[pm::vertex_index(j)];
+        return pi.x < pj.x || (pi.x == pj.x && pi.y < pj.y);
+    });
+
+    std::vector<int> strip_begin = {0};
+    for (auto s = 1; s < num_strips; ++s)
+    {
+        auto b = tg::max(int(int64_t(n) * s / num_strips), strip_begin.back() + 3);
+        while (b < n && position[pm::vertex_index(order[b])].x == position[pm::vertex_index(order[b - 1])].x)
+            ++b;
+        if (n - b < 3)
+            break;
+        strip_begin.push_back(b);
+    }
+    strip_begin.push_back(n);
+    num_strips = int(strip_begin.size()) - 1;
+
+    std::vector<std::unique_ptr<strip>> strips(num_strips);
+    pool.parallel_for(num_strips, 1, [&](int begin, int end) {
+        for (auto s = begin; s < end; ++s)
+        {
+            auto& st = *(strips[s] = std::make_unique<strip>());
+            st.vertices.assign(order.begin() + strip_begin[s], order.begin() + strip_begin[s + 1]);
+            // delabella creates clockwise faces, so it triangulates the points mirrored at the x axis
+            for (auto const v : st.vertices)
+            {
+                auto const p = position[pm::vertex_index(v)];
+                st.position[st.mesh.vertices().add()] = tg::pos2(p.x, -p.y);
+            }
+
+            // fails for collinear strips
+            st.ok = pm::create_delaunay_triangulation(st.mesh, st.position) && !st.mesh.faces().empty();
+            if (st.ok)
+            {
+                // everything below relies on counter-clockwise faces
+                auto const vs = st.mesh.faces().first().vertices().to_array<3>();
+                auto const ps = std::array<tg::pos2, 3>{{position[pm::vertex_index(st.vertices[vs[0].idx.value])],
+                                                         position[pm::vertex_index(st.vertices[vs[1].idx.value])],
+                                                         position[pm::vertex_index(st.vertices[vs[2].idx.value])]}};
+                st.ok = gp::orient2d(ps[0], ps[1], ps[2]) > 0;
+            }
+        }
+    });
+
+    // a collinear strip can still be part of a proper triangulation, retry with everything in one strip
+    if (!std::all_of(strips.begin(), strips.end(), [](auto const& st) { return st->ok; }))
+        return num_strips > 1 && create_delaunay_triangulation(m, position, 1);
+
+    // copy the strip topologies into the mesh, every strip owns a contiguous range of faces and halfedges
+    std::vector<int> face_offset(num_strips + 1, 0);
+    std::vector<int> halfedge_offset(num_strips + 1, 0);
+    for (auto s = 0; s < num_strips; ++s)
+    {
+        face_offset[s + 1] = face_offset[s] + strips[s]->mesh.all_faces().size();
+        halfedge_offset[s + 1] = halfedge_offset[s] + strips[s]->mesh.all_halfedges().size();
+    }
+
+    auto ll = pm::low_level_api(m);
+    ll.alloc_primitives(0, face_offset.back(), halfedge_offset.back());
+
+    pool.parallel_for(num_strips, 1, [&](int begin, int end) {
+        for (auto s = begin; s < end; ++s)
+        {
+            auto const& st = *strips[s];
+            auto const sll = pm::low_level_api(st.mesh);
+            auto const fo = face_offset[s];
+            auto const ho = halfedge_offset[s];
+
+            for (auto h = 0; h < st.mesh.all_halfedges().size(); ++h)
+            {
+                auto const sh = pm::halfedge_index(h);
+                auto const mh = pm::halfedge_index(ho + h);
+                auto const f = sll.face_of(sh);
+                ll.to_vertex_of(mh) = pm::vertex_index(st.vertices[sll.to_vertex_of(sh).value]);
+                ll.face_of(mh) = f.is_valid() ? pm::face_index(fo + f.value) : pm::face_index();
+                ll.next_halfedge_of(mh) = pm::halfedge_index(ho + sll.next_halfedge_of(sh).value);
+                ll.prev_halfedge_of(mh) = pm::halfedge_index(ho + sll.prev_halfedge_of(sh).value);
+            }
+
+            for (auto f = 0; f < st.mesh.all_faces().size(); ++f)
+                ll.halfedge_of(pm::face_index(fo + f)) = pm::halfedge_index(ho + sll.halfedge_of(pm::face_index(f)).value);
+
+            // delabella drops duplicate points, their copies stay isolated
+            for (auto v = 0; v < st.mesh.all_vertices().size(); ++v)
+            {
+                auto const h = sll.outgoing_halfedge_of(pm::vertex_index(v));
+                ll.outgoing_halfedge_of(pm::vertex_index(st.vertices[v])) = h.is_valid() ? pm::halfedge_index(ho + h.value) : pm::halfedge_index();
+            }
+        }
+    });
+    strips.clear();
+
+    // stitch every strip to everything left of it, then repair the seams
+    // equal points are never split between strips, so the last and first triangulated points are hull vertices
+    // (every strip has faces, so they exist within the strips)
+    auto const triangulated = [&](int i) { return !pm::vertex_index(order[i]).of(m).is_isolated(); };
+    std::vector<pm::edge_index> seam;
+    for (auto s = 1; s < num_strips; ++s)
+    {
+        auto r = strip_begin[s] - 1;
+        while (!triangulated(r))
+            --r;
+        auto l = strip_begin[s];
+        while (!triangulated(l))
+            ++l;
+        stitch(m, position, pm::vertex_index(order[r]).of(m), pm::vertex_index(order[l]).of(m), seam);
+    }
+
+    auto const seam_edges = int(seam.size());
+    auto const flips = make_delaunay(m, position, std::move(seam));
+    GP_TRACE(gp::trace::info, "[delaunay] {} strips, {} seam edges, {} flips", num_strips, seam_edges, flips);
+
+    return true;
+}
+
+void gp::remove_vertex(pm::Mesh& m, pm::vertex_attribute<tg::pos2> const& position, pm::vertex_handle v)
+{
+    if (v.is_isolated())
+    {
+        m.vertices().remove(v);
+        return;
+    }
+
+    bool closed;
+    auto const link = link_of(v, closed);
+    m.vertices().remove(v);
+
+    // the ears are Delaunay w.r.t. the link, for a boundary vertex points behind the chain can still be in their circle
+    std::vector<pm::edge_index> edges;
+    fill_link(m, position, link, closed, edges);
+    auto const flips = make_delaunay(m, position, std::move(edges));
+    GP_TRACE(gp::trace::debug, "[delaunay] removed vertex {} of valence {}, {} flips", v.idx.value, int(link.size()) - !closed, flips);
+}
+
+bool gp::move_vertex(pm::Mesh& m, pm::vertex_attribute<tg::pos2>& position, pm::vertex_handle v, tg::pos2 const& p)
+{
+    if (v.is_isolated())
+    {
+        position[v] = p;
+        return true;
+    }
+
+    bool closed;
+    auto const link = link_of(v, closed);
+    auto const n = int(link.size());
+
+    // a hull vertex may only move while the hull keeps its faces: v and its hull neighbors stay convex corners
+    if (!closed)
+    {
+        auto const ccw = link.front();
+        auto const cw = link.back();
+        auto const ccw_next = boundary_ccw(ccw);
+        auto const cw_prev = boundary_cw(cw);
+        if (gp::orient2d(position[cw], p, position[ccw]) <= 0)
+            return false;
+        if (cw_prev != ccw && gp::orient2d(position[cw_prev], position[cw], p) <= 0)
+            return false;
+        if (ccw_next != cw && gp::orient2d(p, position[ccw], position[ccw_next]) <= 0)
+            return false;
+    }
+
+    // kinetic case: the star stays valid, only edges around v can become non-Delaunay
+    auto star_valid = true;
+    for (auto i = 0; i < (closed ? n : n - 1) && star_valid; ++i)
+        star_valid = gp::orient2d(p, position[link[i]], position[link[(i + 1) % n]]) > 0;
+
+    std::vector<pm::edge_index> edges;
+    if (star_valid)
+    {
+        position[v] = p;
+        add_star_edges(v, edges);
+        auto const flips = make_delaunay(m, position, std::move(edges));
+        GP_TRACE(gp::trace::debug, "[delaunay] moved vertex {} within its star, {} flips", v.idx.value, flips);
+        return true;
+    }
+
+    // would fold over a hull face
+    if (!closed)
+        return false;
+
+    // locate p while the triangulation is still intact, starting from v
+    gp::point_locator locator(position, 1);
+    locator.set_hint(v.any_valid_face());
+    auto face = locator.locate(p);
+    if (face.is_invalid() || face.vertices().any([&](pm::vertex_handle w) { return w != v && position[w] == p; }))
+        return false;
+
+    // take v out (it stays as an isolated vertex), the hull does not change for an interior vertex
+    auto const spokes = v.edges().to_vector();
+    for (auto const e : spokes)
+        m.edges().remove(e);
+    fill_link(m, position, link, closed, edges);
+    auto flips = make_delaunay(m, position, std::move(edges));
+
+    // insert it again at p, the face found before might have been part of the star
+    if (face.is_removed())
+    {
+        locator.set_hint(link.front().any_valid_face());
+        face = locator.locate(p);
+    }
+    // on an edge, split it instead of creating a flat face (that could not be flipped away on the hull)
+    position[v] = p;
+    pm::halfedge_handle on_edge;
+    for (auto const h : face.halfedges())
+        if (gp::orient2d(position[h.vertex_from()], position[h.vertex_to()], p) == 0)
+            on_edge = h;
+    if (on_edge.is_valid())
+        m.edges().split_and_triangulate(on_edge.edge(), v);
+    else
+        m.faces().split(face, v);
+
+    edges.clear();
+    add_star_edges(v, edges);
+    flips += make_delaunay(m, position, std::move(edges));
+    GP_TRACE(gp::trace::debug, "[delaunay] moved vertex {} out of its star, {} flips", v.idx.value, flips);
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+/// Given a 2D triangulation (counter-clockwise faces), performs edge flips until all edges are Delaunay
+/// same as pm::make_delaunay, but uses the exact incircle test of task::is_delaunay instead of the
+/// floating point cotan weights of the 3D version, so it terminates for (nearly) cocircular points
+/// returns the number of flips
+int make_delaunay(pm::Mesh& m, pm::vertex_attribute<tg::pos2> const& position);
+
+/// same as above, but only starts from the given edges (and the ones around flipped edges)
+/// repairs a triangulation that is Delaunay except around these edges in time proportional to the damage
+int make_delaunay(pm::Mesh& m, pm::vertex_attribute<tg::pos2> const& position, std::vector<pm::edge_index> queue);
+
+/// Given a 2D mesh filled with vertices, creates a Delaunay triangulation with counter-clockwise faces
+/// same triangulation as pm::create_delaunay_triangulation (whose faces are clockwise), but divide-and-conquer over vertical strips:
+///   - the points are split by x into num_strips strips of equal size
+///   - every strip is triangulated on its own (delabella), in parallel on gp::thread_pool::global()
+///   - the strip triangulations are written directly into the mesh (low-level API), in parallel
+///   - neighboring strips are stitched by triangulating the gap between their convex hulls,
+///     followed by edge flips that only touch the region around the seams
+/// num_strips <= 0 uses one strip per thread (and a single strip for small inputs)
+/// NOTE: requires at least 3 vertices, the mesh must not have edges or faces
+///       returns false if all points are collinear, of several equal points all but one stay isolated
+bool create_delaunay_triangulation(pm::Mesh& m, pm::vertex_attribute<tg::pos2> const& position, int num_strips = 0);
+
+/// Given a Delaunay triangulation (counter-clockwise faces, convex boundary), removes v and fills the hole left by
+/// its star ear by ear, always clipping an ear whose circumcircle contains no other vertex of the star
+/// (for a vertex on the boundary, only the pocket between the old and the new convex hull is filled)
+/// costs O(k^3) in the worst case for a vertex of valence k (k ears, each found by an O(k) search with an O(k)
+/// empty-circle test per candidate), plus the flips around the hole (usually none)
+void remove_vertex(pm::Mesh& m, pm::vertex_attribute<tg::pos2> const& position, pm::vertex_handle v);
+
+/// Given a Delaunay triangulation (counter-clockwise faces, convex boundary), moves v to p and repairs the triangulation:
+///   - if no face around v flips over, the edges around v are flipped until they are Delaunay again
+///   - otherwise, v is taken out (its star is filled as in remove_vertex) and inserted again at p,
+///     walking from its old star, so v keeps its index and attributes
+/// the cost is proportional to the star of v (and the walk to p), independent of the mesh size
+/// returns false (and changes nothing) if p lies outside of the triangulation or on another vertex,
+/// or if v is on the boundary and the move would change the faces of the convex hull
+bool move_vertex(pm::Mesh& m, pm::vertex_attribute<tg::pos2>& position, pm::vertex_handle v, tg::pos2 const& p);
+}
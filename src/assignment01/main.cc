@@ -1,5 +1,11 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <iostream>
+#include <iterator>
 #include <queue>
+#include <string>
+#include <vector>
 
 #include <imgui/imgui.h>
 
@@ -8,13 +14,21 @@
 #include <glow-extras/viewer/experimental.hh>
 
 #include <polymesh/Mesh.hh>
+#include <polymesh/algorithms/delaunay.hh>
 #include <polymesh/objects/cone.hh>
 #include <polymesh/properties.hh>
 
 #include <typed-geometry/functions/objects/triangle.hh>
 #include <typed-geometry/tg.hh>
 
+#include <common/predicates.hh>
+#include <common/trace.hh>
+
+#include "bulk_insertion.hh"
+#include "delaunay.hh"
+#include "point_location.hh"
 #include "task.hh"
+#include "voronoi.hh"
 
 namespace gp
 {
@@ -22,24 +36,8 @@ bool in_face(tg::pos2 const& point, pm::face_handle f, pm::vertex_attribute<tg::
 {
     auto const ps = f.vertices().to_array<3>(position);
 
-    auto const v0 = ps[2] - ps[0];
-    auto const v1 = ps[1] - ps[0];
-    auto const v2 = point - ps[0];
-
-    // Compute dot products
-    auto const dot00 = dot(v0, v0);
-    auto const dot01 = dot(v0, v1);
-    auto const dot02 = dot(v0, v2);
-    auto const dot11 = dot(v1, v1);
-    auto const dot12 = dot(v1, v2);
-
-    // Compute barycentric coordinates
-    auto const invDenom = 1.0 / (dot00 * dot11 - dot01 * dot01);
-    auto const u = (dot11 * dot02 - dot01 * dot12) * invDenom;
-    auto const v = (dot00 * dot12 - dot01 * dot02) * invDenom;
-
-    // Check if point is in triangle
-    return (u >= 0) && (v >= 0) && (u + v < 1);
+    // inside or on the boundary of the counter-clockwise triangle
+    return gp::orient2d(ps[0], ps[1], point) >= 0 && gp::orient2d(ps[1], ps[2], point) >= 0 && gp::orient2d(ps[2], ps[0], point) >= 0;
 }
 
 void project_to_paraboloid(pm::Mesh const& mesh, pm::vertex_attribute<tg::pos2> const& pos2d, pm::vertex_attribute<tg::pos3>& pos3d)
@@ -51,10 +49,171 @@ void project_to_paraboloid(pm::Mesh const& mesh, pm::vertex_attribute<tg::pos2>
     }
 }
 
+/// inserts uniformly random points into the unit square triangulation one at a time,
+/// for 1000, 10000, ... up to max_points points, and reports the time per insertion and per point location
+void benchmark_insertion(int max_points)
+{
+    for (auto n = 1000; n <= max_points; n *= 10)
+    {
+        tg::rng rng;
+        pm::Mesh mesh;
+        pm::vertex_attribute<tg::pos2> position(mesh);
+        auto const v0 = mesh.vertices().add();
+        auto const v1 = mesh.vertices().add();
+        auto const v2 = mesh.vertices().add();
+        auto const v3 = mesh.vertices().add();
+        position[v0] = tg::pos2(-0.5, -0.5);
+        position[v1] = tg::pos2(0.5, -0.5);
+        position[v2] = tg::pos2(0.5, 0.5);
+        position[v3] = tg::pos2(-0.5, 0.5);
+        mesh.faces().add(v0, v1, v2);
+        mesh.faces().add(v0, v2, v3);
+
+        point_locator locator(position);
+        auto const bounds = tg::aabb2(tg::pos2(-0.5f), tg::pos2(0.5f));
+
+        // point location and insertion are timed separately, the walk length grows with the mesh for random points
+        auto locate_seconds = 0.0;
+        auto insert_seconds = 0.0;
+        for (auto i = 0; i < n; ++i)
+        {
+            auto const p = tg::uniform(rng, bounds);
+            auto const t0 = std::chrono::steady_clock::now();
+            auto const f = locator.locate(p);
+            auto const t1 = std::chrono::steady_clock::now();
+            auto const v = task::insert_vertex(mesh, position, p, f);
+            auto const t2 = std::chrono::steady_clock::now();
+            locator.set_hint(mesh.vertices()[v].any_valid_face());
+
+            locate_seconds += std::chrono::duration<double>(t1 - t0).count();
+            insert_seconds += std::chrono::duration<double>(t2 - t1).count();
+        }
+
+        std::cout << n << " points: insertion " << insert_seconds * 1e6 / n << " us per point, location " << locate_seconds * 1e6 / n
+                  << " us per point" << std::endl;
+    }
+}
+
+/// triangulates 100000, 1000000, ... up to max_points uniformly random points plus the corners of the unit square
+/// with pm::create_delaunay_triangulation, gp::insert_vertices, and gp::create_delaunay_triangulation,
+/// and compares time and result
+void benchmark_bulk_insertion(int max_points)
+{
+    auto const corners = std::array<tg::pos2, 4>{{{-0.5f, -0.5f}, {0.5f, -0.5f}, {0.5f, 0.5f}, {-0.5f, 0.5f}}};
+
+    for (auto n = 100000; n <= max_points; n *= 10)
+    {
+        tg::rng rng;
+        auto const bounds = tg::aabb2(tg::pos2(-0.5f), tg::pos2(0.5f));
+        std::vector<tg::pos2> points(n);
+        for (auto& p : points)
+            p = tg::uniform(rng, bounds);
+
+        // faces as sorted triples of point ids (corners first, then the points)
+        auto const face_ids = [](pm::Mesh const& m, pm::vertex_attribute<int> const& id) {
+            std::vector<std::array<int, 3>> faces;
+            faces.reserve(m.faces().size());
+            for (auto const f : m.faces())
+            {
+                std::array<int, 3> t = {};
+                auto i = 0;
+                for (auto const v : f.vertices())
+                    t[i++] = id[v];
+                std::sort(t.begin(), t.end());
+                faces.push_back(t);
+            }
+            std::sort(faces.begin(), faces.end());
+            return faces;
+        };
+
+        std::vector<std::array<int, 3>> bulk_faces;
+        double bulk_seconds;
+        {
+            pm::Mesh mesh;
+            pm::vertex_attribute<tg::pos2> position(mesh);
+            for (auto const& c : corners)
+                position[mesh.vertices().add()] = c;
+            mesh.faces().add(pm::vertex_index(0).of(mesh), pm::vertex_index(1).of(mesh), pm::vertex_index(2).of(mesh));
+            mesh.faces().add(pm::vertex_index(0).of(mesh), pm::vertex_index(2).of(mesh), pm::vertex_index(3).of(mesh));
+
+            auto const start = std::chrono::steady_clock::now();
+            auto const vertices = gp::insert_vertices(mesh, position, points);
+            bulk_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            auto id = mesh.vertices().make_attribute<int>(-1);
+            for (auto i = 0; i < 4; ++i)
+                id[pm::vertex_index(i)] = i;
+            for (auto i = 0; i < n; ++i)
+                if (vertices[i].is_valid())
+                    id[vertices[i]] = 4 + i;
+            bulk_faces = face_ids(mesh, id);
+        }
+
+        std::vector<std::array<int, 3>> delabella_faces;
+        double delabella_seconds;
+        {
+            pm::Mesh mesh;
+            pm::vertex_attribute<tg::pos2> position(mesh);
+            for (auto const& c : corners)
+                position[mesh.vertices().add()] = c;
+            for (auto const& p : points)
+                position[mesh.vertices().add()] = p;
+
+            auto const start = std::chrono::steady_clock::now();
+            pm::create_delaunay_triangulation(mesh, position);
+            delabella_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            auto id = mesh.vertices().map([](pm::vertex_handle v) { return v.idx.value; });
+            delabella_faces = face_ids(mesh, id);
+        }
+
+        std::vector<std::array<int, 3>> strips_faces;
+        double strips_seconds;
+        {
+            pm::Mesh mesh;
+            pm::vertex_attribute<tg::pos2> position(mesh);
+            for (auto const& c : corners)
+                position[mesh.vertices().add()] = c;
+            for (auto const& p : points)
+                position[mesh.vertices().add()] = p;
+
+            auto const start = std::chrono::steady_clock::now();
+            gp::create_delaunay_triangulation(mesh, position);
+            strips_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            auto id = mesh.vertices().map([](pm::vertex_handle v) { return v.idx.value; });
+            strips_faces = face_ids(mesh, id);
+        }
+
+        auto const num_different = [&](std::vector<std::array<int, 3>> const& faces) {
+            std::vector<std::array<int, 3>> difference;
+            std::set_symmetric_difference(faces.begin(), faces.end(), delabella_faces.begin(), delabella_faces.end(), std::back_inserter(difference));
+            return difference.size();
+        };
+
+        std::cout << n << " points: delabella " << delabella_seconds << " s (" << delabella_faces.size() << " faces), bulk insertion "
+                  << bulk_seconds << " s (" << num_different(bulk_faces) << " faces differ), parallel strips " << strips_seconds << " s ("
+                  << num_different(strips_faces) << " faces differ)" << std::endl;
+    }
+}
 }
 
-int main(int /*argc*/, char** /*args*/)
+int main(int argc, char** args)
 {
+    // --benchmark-insertion [max #points]
+    if (argc >= 2 && std::string(args[1]) == "--benchmark-insertion")
+    {
+        gp::benchmark_insertion(argc >= 3 ? std::stoi(args[2]) : 1000000);
+        return 0;
+    }
+
+    // --benchmark-bulk-insertion [max #points]
+    if (argc >= 2 && std::string(args[1]) == "--benchmark-bulk-insertion")
+    {
+        gp::benchmark_bulk_insertion(argc >= 3 ? std::stoi(args[2]) : 10000000);
+        return 0;
+    }
+
     glow::glfw::GlfwContext ctx;
     tg::rng rng;
 
@@ -128,14 +287,71 @@ int main(int /*argc*/, char** /*args*/)
 
     reset();
 
+    // finds the triangle containing a point in (expected) sublinear time
+    gp::point_locator locator(position);
+
+    // explicit Voronoi cells, clipped to the unit square
+    gp::voronoi_diagram voronoi(position, tg::aabb2(tg::pos2(-0.5f), tg::pos2(0.5f)));
+    std::vector<tg::segment3> voronoi_edges;
+    auto const update_voronoi_edges = [&]() {
+        voronoi_edges.clear();
+        for (auto const v : mesh.vertices())
+        {
+            auto const cell = voronoi.cell(v);
+            for (auto i = 0u; i < cell.size(); ++i)
+                voronoi_edges.emplace_back(tg::pos3(cell[i].x, cell[i].y, 0.002f), tg::pos3(cell[(i + 1) % cell.size()].x, cell[(i + 1) % cell.size()].y, 0.002f));
+        }
+    };
+    update_voronoi_edges();
+
+    // inserts a vertex at p if p lies inside the triangulation and is not an existing vertex
+    auto const insert_point = [&](tg::pos2 const& p, pm::face_handle face) {
+        if (face.is_invalid() || face.vertices().any([&](pm::vertex_handle v) { return position[v] == p; }))
+            return false;
+
+        auto const v = task::insert_vertex(mesh, position, p, face);
+        color[v] = tg::uniform<tg::color3>(rng);
+        pos3d[v] = tg::pos3(p);
+        add_cone(tg::pos3(position[v]), color[v]);
+        locator.set_hint(mesh.vertices()[v].any_valid_face());
+        voronoi.update_around(mesh.vertices()[v]);
+        update_voronoi_edges();
+        return true;
+    };
+
+    // removes the vertex, its cell (now empty) and the cells of its old neighbors are the only ones that change
+    // the four corners are kept, so the triangulation always covers the square
+    auto const remove_point = [&](pm::vertex_handle v) {
+        if (v.idx.value < 4)
+            return false;
+
+        auto vertices = v.adjacent_vertices().to_vector();
+        vertices.push_back(v);
+        gp::remove_vertex(mesh, position, v);
+        voronoi.update_vertices(vertices);
+        update_voronoi_edges();
+        return true;
+    };
+
+    auto const rebuild_cones = [&]() {
+        cones.clear();
+        for (auto const v : mesh.vertices())
+            add_cone(tg::pos3(position[v]), color[v]);
+    };
+
     // app state
     bool show_cones = true;
+    bool show_voronoi_cells = false;
     bool show_triangulation = true;
     bool show_vertices = true;
     bool show_hovered_circumcircle = false;
     bool mouse_locked = false;
     bool show_paraboloid = false;
     bool lock_camera = true;
+    bool remove_on_click = false;
+    float jitter = 0.01f;
+    int num_random_points = 100;
+    float hovered_cell_area = 0;
 
     std::vector<tg::segment3> circumcircle;
 
@@ -165,20 +381,71 @@ int main(int /*argc*/, char** /*args*/)
 
             ImGui::Begin("Options");
             changed |= ImGui::Checkbox("Show Voronoi", &show_cones);
+            changed |= ImGui::Checkbox("Show Voronoi Cells", &show_voronoi_cells);
             changed |= ImGui::Checkbox("Show Delaunay", &show_triangulation);
             changed |= ImGui::Checkbox("Show Vertices", &show_vertices);
             changed |= ImGui::Checkbox("Show Circumcircle", &show_hovered_circumcircle);
             changed |= ImGui::Checkbox("Show Paraboloid", &show_paraboloid);
             changed |= ImGui::Checkbox("Lock Camera", &lock_camera);
+            ImGui::Checkbox("Remove On Click", &remove_on_click);
 
             if (ImGui::Button("Reset"))
             {
                 changed = true;
                 reset();
+                voronoi.rebuild();
+                update_voronoi_edges();
                 cone_r = gv::make_renderable(cone_pos);
                 cone_r->addAttribute(gv::detail::make_mesh_attribute("aColor", cone_color));
                 line_r = gv::make_renderable(gv::lines(pos3d).camera_facing());
             }
+            if (ImGui::Button("Dump Trace"))
+                gp::trace::dump(std::cout);
+            ImGui::InputInt("Random Points", &num_random_points);
+            if (ImGui::Button("Insert Random Points"))
+            {
+                changed = true;
+                auto const bounds = tg::aabb2(tg::pos2(-0.5f), tg::pos2(0.5f));
+                std::vector<tg::pos2> points(tg::max(num_random_points, 0));
+                for (auto& p : points)
+                    p = tg::uniform(rng, bounds);
+
+                for (auto const v : gp::insert_vertices(mesh, position, points))
+                {
+                    if (v.is_invalid())
+                        continue;
+                    color[v] = tg::uniform<tg::color3>(rng);
+                    pos3d[v] = tg::pos3(position[v]);
+                    add_cone(tg::pos3(position[v]), color[v]);
+                }
+                voronoi.rebuild();
+                update_voronoi_edges();
+                cone_r = gv::make_renderable(cone_pos);
+                cone_r->addAttribute(gv::detail::make_mesh_attribute("aColor", cone_color));
+                line_r = gv::make_renderable(gv::lines(pos3d).camera_facing());
+            }
+            ImGui::InputFloat("Jitter", &jitter);
+            if (ImGui::Button("Jitter Points"))
+            {
+                // every vertex except the corners takes a small random step, the triangulation is repaired locally
+                changed = true;
+                for (auto const v : mesh.vertices())
+                {
+                    if (v.idx.value < 4)
+                        continue;
+                    auto const p = tg::clamp(position[v] + jitter * tg::uniform_vec(rng, tg::aabb2::minus_one_to_one), tg::pos2(-0.5f), tg::pos2(0.5f));
+                    if (gp::move_vertex(mesh, position, v, p))
+                        pos3d[v] = tg::pos3(p);
+                }
+                voronoi.rebuild();
+                update_voronoi_edges();
+                rebuild_cones();
+                cone_r = gv::make_renderable(cone_pos);
+                cone_r->addAttribute(gv::detail::make_mesh_attribute("aColor", cone_color));
+                line_r = gv::make_renderable(gv::lines(pos3d).camera_facing());
+            }
+            if (show_voronoi_cells)
+                ImGui::Text("Hovered Cell Area: %f", hovered_cell_area);
             ImGui::End();
 
             auto const mouse_pos = gv::experimental::interactive_get_mouse_position();
@@ -187,24 +454,28 @@ int main(int /*argc*/, char** /*args*/)
             {
                 --skip;
             }
-            else if (ImGui::IsMouseClicked(0) || show_hovered_circumcircle)
+            else if (ImGui::IsMouseClicked(0) || show_hovered_circumcircle || show_voronoi_cells)
             {
                 auto const pick = gv::experimental::interactive_get_position(mouse_pos);
                 if (pick.has_value() && !ImGui::GetIO().WantCaptureMouse)
                 {
                     auto const pick_pos = tg::pos2(pick.value());
-                    pm::face_handle picked_face;
-                    for (auto const f : mesh.faces())
+                    auto const picked_face = locator.locate(pick_pos);
+
+                    if (picked_face.is_valid())
                     {
-                        if (gp::in_face(pick_pos, f, position))
+                        // the cell containing the point belongs to the closest site,
+                        // greedy descent over the Delaunay edges from a corner of the face finds it
+                        auto closest = picked_face.vertices().first();
+                        for (auto improved = true; improved;)
                         {
-                            picked_face = f;
-                            break;
+                            auto const next = closest.adjacent_vertices().min_by([&](pm::vertex_handle v) { return tg::distance_sqr(position[v], pick_pos); });
+                            improved = tg::distance_sqr(position[next], pick_pos) < tg::distance_sqr(position[closest], pick_pos);
+                            if (improved)
+                                closest = next;
                         }
-                    }
+                        hovered_cell_area = voronoi.cell_area(closest);
 
-                    if (picked_face.is_valid())
-                    {
                         if (show_hovered_circumcircle)
                         {
                             changed = true;
@@ -228,13 +499,11 @@ int main(int /*argc*/, char** /*args*/)
 
                         if (ImGui::IsMouseClicked(0))
                         {
-                            if (position.all([&](tg::pos2 p) { return p != pick_pos; }))
+                            if (remove_on_click ? remove_point(closest) : insert_point(pick_pos, picked_face))
                             {
+                                if (remove_on_click)
+                                    rebuild_cones();
                                 changed = true;
-                                auto const v = task::insert_vertex(mesh, position, pick_pos, picked_face);
-                                color[v] = tg::uniform<tg::color3>(rng);
-                                pos3d[v] = tg::pos3(pick_pos);
-                                add_cone(tg::pos3(position[v]), color[v]);
                                 cone_r = gv::make_renderable(cone_pos);
                                 cone_r->addAttribute(gv::detail::make_mesh_attribute("aColor", cone_color));
                                 line_r = gv::make_renderable(gv::lines(pos3d).camera_facing());
@@ -279,6 +548,9 @@ int main(int /*argc*/, char** /*args*/)
                 if (show_cones)
                     gv::view(cone_r, gv::no_shading, gv::no_outline, gv::no_fresnel);
 
+                if (show_voronoi_cells)
+                    gv::view(gv::lines(voronoi_edges).camera_facing(), tg::color3::black, gv::maybe_empty);
+
                 if (show_vertices)
                 {
                     auto c = gv::canvas();
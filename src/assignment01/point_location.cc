@@ -0,0 +1,107 @@
+#include "point_location.hh"
+
+#include <typed-geometry/tg.hh>
+
+#include <common/predicates.hh>
+
+gp::point_locator::point_locator(pm::vertex_attribute<tg::pos2> const& position, int num_samples)
+  : _mesh(&position.mesh()), _position(&position), _num_samples(num_samples)
+{
+}
+
+pm::face_handle gp::point_locator::locate(tg::pos2 const& p)
+{
+    auto const start = start_face(p);
+    if (start.is_invalid())
+        return {};
+
+    auto const f = walk(start, p);
+    if (f.is_valid())
+        _hint = f;
+    return f;
+}
+
+pm::face_handle gp::point_locator::start_face(tg::pos2 const& p)
+{
+    auto const& position = *_position;
+    auto const n = _mesh->all_vertices().size();
+    if (n == 0 || _mesh->faces().empty())
+        return {};
+
+    pm::face_handle best_face;
+    auto best_dist = tg::max<float>();
+
+    // the hint is only valid as long as the face was not removed in the meantime
+    if (_hint.is_valid() && _hint.idx.value < _mesh->all_faces().size() && !_mesh->faces()[_hint.idx].is_removed())
+    {
+        best_face = _mesh->faces()[_hint.idx];
+        for (auto const v : best_face.vertices())
+            best_dist = tg::min(best_dist, tg::distance_sqr(position[v], p));
+    }
+
+    auto const num_samples = _num_samples > 0 ? _num_samples : tg::max(1, int(tg::pow(float(n), 1.0f / 3.0f)));
+    for (auto i = 0; i < num_samples; ++i)
+    {
+        auto const v = _mesh->vertices()[pm::vertex_index(tg::uniform(_rng, 0, n - 1))];
+        if (v.is_removed() || v.is_isolated())
+            continue;
+
+        auto const d = tg::distance_sqr(position[v], p);
+        if (d < best_dist)
+        {
+            best_dist = d;
+            best_face = v.any_valid_face();
+        }
+    }
+
+    // no usable sample (e.g. only a few vertices left), fall back to any face
+    if (best_face.is_invalid())
+        best_face = _mesh->faces().first();
+
+    return best_face;
+}
+
+pm::face_handle gp::point_locator::walk(pm::face_handle f, tg::pos2 const& p)
+{
+    auto const& position = *_position;
+    pm::halfedge_handle entry; // halfedge through which the current face was entered
+
+    // a walk never visits more faces than there are, anything longer is a cycle (e.g. degenerate faces)
+    auto const max_steps = _mesh->all_faces().size();
+    for (auto step = 0; step <= max_steps; ++step)
+    {
+        // test the edges starting at a random one, p lies to the left of all edges of the face containing it
+        auto h = f.any_halfedge();
+        for (auto i = tg::uniform(_rng, 0, 2); i > 0; --i)
+            h = h.next();
+
+        auto crossed = false;
+        for (auto i = 0; i < 3; ++i, h = h.next())
+        {
+            if (h == entry || gp::orient2d(position[h.vertex_from()], position[h.vertex_to()], p) >= 0)
+                continue;
+
+            f = h.opposite_face();
+            if (f.is_invalid())
+                return {}; // left the (convex) triangulation
+
+            entry = h.opposite();
+            crossed = true;
+            break;
+        }
+
+        if (!crossed)
+            return f;
+    }
+
+    // cycled, locate by brute force
+    for (auto const face : _mesh->faces())
+    {
+        auto inside = true;
+        for (auto const h : face.halfedges())
+            inside = inside && gp::orient2d(position[h.vertex_from()], position[h.vertex_to()], p) >= 0;
+        if (inside)
+            return face;
+    }
+    return {};
+}
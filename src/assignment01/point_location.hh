@@ -0,0 +1,33 @@
+#pragma once
+
+#include <polymesh/Mesh.hh>
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+/// point location in a 2D triangulation with counter-clockwise faces and a convex boundary (jump-and-walk)
+/// a query starts at the face found by the previous query or at the nearest of a few randomly sampled vertices,
+/// whichever is closer, and walks towards the point through the edges that separate it from the current face
+/// NOTE: the locator only keeps a hint into the mesh, so the mesh can be modified between queries
+struct point_locator
+{
+    /// num_samples <= 0 samples about cbrt(#vertices) vertices per query
+    explicit point_locator(pm::vertex_attribute<tg::pos2> const& position, int num_samples = 0);
+
+    /// face containing p (points on edges belong to either face), invalid if p lies outside of the triangulation
+    pm::face_handle locate(tg::pos2 const& p);
+
+    /// start the next query at f (e.g. a face next to a vertex that was just inserted)
+    void set_hint(pm::face_handle f) { _hint = f; }
+
+private:
+    pm::face_handle start_face(tg::pos2 const& p);
+    pm::face_handle walk(pm::face_handle f, tg::pos2 const& p);
+
+    pm::Mesh const* _mesh;
+    pm::vertex_attribute<tg::pos2> const* _position;
+    int _num_samples;
+    pm::face_handle _hint;
+    tg::rng _rng; ///< for sampling and randomizing the walk (a deterministic walk can cycle in non-Delaunay triangulations)
+};
+}
@@ -1,12 +1,15 @@
 #include "task.hh"
 
-#include <iostream>
 #include <queue>
 
 #include <typed-geometry/feature/matrix.hh>
 #include <typed-geometry/feature/std-interop.hh>
 #include <typed-geometry/feature/vector.hh>
 
+#include <common/epoch_set.hh>
+#include <common/predicates.hh>
+#include <common/trace.hh>
+
 bool task::is_delaunay(polymesh::edge_handle edge, pm::vertex_attribute<tg::pos2> const& position)
 {
     auto const va = edge.halfedgeA().next().vertex_to();
@@ -35,48 +38,10 @@ bool task::is_delaunay(polymesh::edge_handle edge, pm::vertex_attribute<tg::pos2
     // is the edge delaunay or not?
     // -> circum-circle test of the four points (a,b,c,d) OR check if the projected paraboloid is convex
     //--- start strip ---
-    tg::pos2 const& mid_ab = { (a.x + b.x) / 2, (a.y + b.y) / 2 };
-    float slope_normal_ab = std::numeric_limits<float>::infinity();
-    float intercept_normal_ab = std::numeric_limits<float>::infinity();
-    if (b.y != a.y) {
-        slope_normal_ab = -(b.x - a.x) / (b.y - a.y);
-        intercept_normal_ab = mid_ab.y - (slope_normal_ab * mid_ab.x);
-    }
-
-    tg::pos2 const& mid_ac = { (a.x + c.x) / 2, (a.y + c.y) / 2 };
-    float slope_normal_ac = 0.f;
-    float intercept_normal_ac = 0.f;
-    if (c.y != a.y) {
-        slope_normal_ac = -(c.x - a.x) / (c.y - a.y);
-        intercept_normal_ac = mid_ac.y - (slope_normal_ac * mid_ac.x);
-    }
-
-    if (intercept_normal_ab == intercept_normal_ac) {
-        result = false;
-    }
-    else {
-        float center_x = 0.f;
-        tg::pos2 circumcenter = { center_x, center_x };
-        if (b.y == a.y) {
-            center_x = mid_ab.x;
-            circumcenter = { center_x, (slope_normal_ac * center_x) + intercept_normal_ac };
-        } else if (c.y == a.y) {
-            center_x = mid_ac.x;
-            circumcenter = { center_x, (slope_normal_ab * center_x) + intercept_normal_ab };
-        }
-        else {
-            center_x = (intercept_normal_ac - intercept_normal_ab) / (slope_normal_ab - slope_normal_ac);
-            circumcenter = { center_x, (slope_normal_ab * center_x) + intercept_normal_ab };
-        }
-        float radius = tg::length(a - circumcenter);
-        float dist_d_center = tg::length(d - circumcenter);
-        if (dist_d_center < radius) {
-            result = false;
-        }
-        std::cout << "Circumcenter: " << circumcenter << "Radius: " << radius << "Distance: " << dist_d_center << std::endl;
-    }
-    std::cout << "Lines info: " << slope_normal_ab << intercept_normal_ab << slope_normal_ac << intercept_normal_ac << std::endl;
-    std::cout << "Delauney? " << result << std::endl;
+    // exact incircle test, the face containing a is (b, c, a) in counter-clockwise order
+    // cocircular points count as Delaunay, so such edges are never flipped back and forth
+    result = gp::incircle(b, c, a, d) <= 0;
+    GP_TRACE(gp::trace::verbose, "[delaunay] edge {} is Delaunay: {}", edge.idx.value, result);
     //--- end strip ---
     
     return result;
@@ -91,7 +56,7 @@ polymesh::vertex_index task::insert_vertex(polymesh::Mesh& mesh, pm::vertex_attr
     if (face.is_valid())
     {
         mesh.faces().split(face, v);
-        std::cout << "[delaunay] 1:3 Split: vertex " << v.idx.value << " at position " << vertex_position << " inside triangle " << face.idx.value << std::endl;
+        GP_TRACE(gp::trace::info, "[delaunay] 1:3 split: vertex {} at position ({}, {}) inside triangle {}", v.idx.value, vertex_position.x, vertex_position.y, face.idx.value);
     }
     else
         return {};
@@ -109,10 +74,9 @@ polymesh::vertex_index task::insert_vertex(polymesh::Mesh& mesh, pm::vertex_attr
     //   You can use an std::queue as a container for edges
     //--- start strip ---
     std::queue<polymesh::edge_handle> edges_to_check;
-    auto visited = mesh.edges().make_attribute<bool>();
-    for (auto e : mesh.edges()) {
-        visited[e] = false;
-    }
+    // kept across calls and cleared lazily, so an insertion only pays for the edges it actually touches
+    thread_local gp::epoch_set visited;
+    visited.clear(mesh.all_edges().size());
     
     //auto inserted_vertex = v.idx.value;
 
@@ -128,13 +92,12 @@ polymesh::vertex_index task::insert_vertex(polymesh::Mesh& mesh, pm::vertex_attr
         polymesh::edge_handle current_edge = edges_to_check.front();
         auto current_edge_idx = current_edge.idx.value;
         edges_to_check.pop();
-        std::cout << "Current edge index: " << current_edge_idx << " and edge visited: " << visited[current_edge] << std::endl;
+        GP_TRACE(gp::trace::debug, "[delaunay] current edge index: {} and edge visited: {}", current_edge_idx, visited.contains(current_edge_idx));
         
-        if (visited[current_edge]) {
+        if (!visited.insert(current_edge_idx)) {
             continue;
         }
         else {
-            visited[current_edge] = true;
             if (current_edge.is_boundary()) continue;
             if (is_delaunay(current_edge, position)) {
                 continue;
@@ -154,6 +117,7 @@ polymesh::vertex_index task::insert_vertex(polymesh::Mesh& mesh, pm::vertex_attr
                 }
             }
             mesh.edges().flip(current_edge);
+            GP_TRACE(gp::trace::debug, "[delaunay] flipped edge {}", current_edge_idx);
         }
     }
     //--- end strip ---
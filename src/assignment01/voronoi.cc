@@ -0,0 +1,208 @@
+#include "voronoi.hh"
+
+#include <typed-geometry/tg.hh>
+
+namespace
+{
+tg::pos2 circumcenter_of(tg::pos2 const& p0, tg::pos2 const& p1, tg::pos2 const& p2)
+{
+    // relative to p0 and in double precision, the faces at the hull can be very flat
+    auto const b = tg::dvec2(p1 - p0);
+    auto const c = tg::dvec2(p2 - p0);
+    auto const d = 2 * (b.x * c.y - b.y * c.x);
+    if (d == 0)
+        return tg::pos2((tg::dvec2(p0) + tg::dvec2(p1) + tg::dvec2(p2)) / 3.0);
+
+    auto const b2 = tg::length_sqr(b);
+    auto const c2 = tg::length_sqr(c);
+    return p0 + tg::vec2(float((c.y * b2 - b.y * c2) / d), float((b.x * c2 - c.x * b2) / d));
+}
+
+// Sutherland-Hodgman clipping against the half-plane coord(p) * sign <= bound * sign
+void clip(std::vector<tg::pos2> const& in, std::vector<tg::pos2>& out, int coord, float bound, float sign)
+{
+    out.clear();
+    for (auto i = 0u; i < in.size(); ++i)
+    {
+        auto const& p = in[i];
+        auto const& q = in[(i + 1) % in.size()];
+        auto const p_in = p[coord] * sign <= bound * sign;
+        auto const q_in = q[coord] * sign <= bound * sign;
+
+        if (p_in)
+            out.push_back(p);
+        if (p_in != q_in)
+        {
+            auto const t = (bound - p[coord]) / (q[coord] - p[coord]);
+            auto r = tg::lerp(p, q, t);
+            r[coord] = bound;
+            out.push_back(r);
+        }
+    }
+}
+}
+
+gp::voronoi_diagram::voronoi_diagram(pm::vertex_attribute<tg::pos2> const& position, tg::aabb2 const& bounds)
+  : _mesh(&position.mesh()), _position(&position), _bounds(bounds)
+{
+    rebuild();
+}
+
+void gp::voronoi_diagram::rebuild()
+{
+    _circumcenters.resize(_mesh->all_faces().size());
+    for (auto const f : _mesh->faces())
+        update_circumcenter(f);
+
+    _cell_begin.assign(_mesh->all_vertices().size(), 0);
+    _cell_size.assign(_mesh->all_vertices().size(), 0);
+    _corners.clear();
+    _unused_corners = 0;
+    for (auto const v : _mesh->vertices())
+        update_cell(v);
+}
+
+void gp::voronoi_diagram::update_around(pm::vertex_handle v)
+{
+    resize();
+
+    for (auto const f : v.faces())
+        update_circumcenter(f);
+
+    update_cell(v);
+    for (auto const w : v.adjacent_vertices())
+        update_cell(w);
+
+    compact_if_sparse();
+}
+
+void gp::voronoi_diagram::update_vertices(std::vector<pm::vertex_handle> const& vertices)
+{
+    resize();
+
+    // faces are shared between the vertices, they are just updated more than once
+    for (auto const v : vertices)
+        if (!v.is_removed())
+            for (auto const f : v.faces())
+                update_circumcenter(f);
+
+    for (auto const v : vertices)
+        update_cell(v);
+
+    compact_if_sparse();
+}
+
+void gp::voronoi_diagram::resize()
+{
+    _circumcenters.resize(_mesh->all_faces().size());
+    _cell_begin.resize(_mesh->all_vertices().size(), 0);
+    _cell_size.resize(_mesh->all_vertices().size(), 0);
+}
+
+void gp::voronoi_diagram::compact_if_sparse()
+{
+    // compact: copy the current cells in vertex order
+    if (_unused_corners > int(_corners.size()) / 2)
+    {
+        std::vector<tg::pos2> corners;
+        corners.reserve(_corners.size() - _unused_corners);
+        for (auto i = 0u; i < _cell_begin.size(); ++i)
+        {
+            auto const begin = _corners.begin() + _cell_begin[i];
+            _cell_begin[i] = int(corners.size());
+            corners.insert(corners.end(), begin, begin + _cell_size[i]);
+        }
+        _corners = std::move(corners);
+        _unused_corners = 0;
+    }
+}
+
+pm::span<tg::pos2 const> gp::voronoi_diagram::cell(pm::vertex_handle v) const
+{
+    auto const i = v.idx.value;
+    if (i >= int(_cell_size.size()))
+        return {};
+    return {_corners.data() + _cell_begin[i], size_t(_cell_size[i])};
+}
+
+float gp::voronoi_diagram::cell_area(pm::vertex_handle v) const
+{
+    auto const c = cell(v);
+    auto area = 0.0;
+    for (auto i = 0u; i < c.size(); ++i)
+    {
+        auto const& p = c[i];
+        auto const& q = c[(i + 1) % c.size()];
+        area += double(p.x) * q.y - double(q.x) * p.y;
+    }
+    return float(area / 2);
+}
+
+void gp::voronoi_diagram::update_circumcenter(pm::face_handle f)
+{
+    // start at the smallest vertex index, so the rounding does not depend on the face's current halfedge
+    auto const vs = f.vertices().to_array<3>();
+    auto const s = vs[0].idx < vs[1].idx ? (vs[0].idx < vs[2].idx ? 0 : 2) : (vs[1].idx < vs[2].idx ? 1 : 2);
+    auto const& position = *_position;
+    _circumcenters[f.idx.value] = circumcenter_of(position[vs[s]], position[vs[(s + 1) % 3]], position[vs[(s + 2) % 3]]);
+}
+
+void gp::voronoi_diagram::update_cell(pm::vertex_handle v)
+{
+    auto const i = v.idx.value;
+    _unused_corners += _cell_size[i];
+    _cell_begin[i] = int(_corners.size());
+    _cell_size[i] = 0;
+
+    if (v.is_removed() || v.is_isolated())
+        return;
+
+    auto const& position = *_position;
+    auto const pv = position[v];
+
+    pm::halfedge_handle boundary;
+    for (auto const h : v.outgoing_halfedges())
+        if (h.is_boundary())
+            boundary = h;
+
+    // circumcenters of the faces around v in counter-clockwise order (for boundary vertices, starting after the gap)
+    // the face left of an outgoing halfedge h is followed by the one left of h.prev().opposite()
+    _polygon.clear();
+    auto const start = boundary.is_valid() ? boundary.prev().opposite() : v.any_outgoing_halfedge();
+    auto h = start;
+    do
+    {
+        _polygon.push_back(_circumcenters[h.face().idx.value]);
+        h = h.prev().opposite();
+    } while (h != start && h != boundary);
+
+    // unbounded cell: the Voronoi edges of the two hull edges are rays along their outward normals,
+    // close the polygon far enough outside of the box (the normals are less than 180 degrees apart)
+    if (boundary.is_valid())
+    {
+        auto const right_normal = [](tg::vec2 d) { return tg::normalize_safe(tg::vec2(d.y, -d.x)); };
+        auto const n_first = right_normal(position[start.vertex_to()] - pv);
+        auto const n_last = right_normal(pv - position[boundary.vertex_to()]);
+        auto const bisector = tg::normalize_safe(n_first + n_last);
+
+        auto const center = tg::centroid_of(_bounds);
+        auto radius = tg::distance(pv, center);
+        for (auto const& p : _polygon)
+            radius = tg::max(radius, tg::distance(p, center));
+        auto const far = 4 * (radius + tg::length(_bounds.max - _bounds.min));
+
+        auto const first = _polygon.front();
+        auto const last = _polygon.back();
+        _polygon.push_back(last + n_last * far);
+        _polygon.push_back(pv + bisector * far);
+        _polygon.push_back(first + n_first * far);
+    }
+
+    clip(_polygon, _clipped, 0, _bounds.min.x, -1);
+    clip(_clipped, _polygon, 0, _bounds.max.x, 1);
+    clip(_polygon, _clipped, 1, _bounds.min.y, -1);
+    clip(_clipped, _polygon, 1, _bounds.max.y, 1);
+
+    _corners.insert(_corners.end(), _polygon.begin(), _polygon.end());
+    _cell_size[i] = int(_polygon.size());
+}
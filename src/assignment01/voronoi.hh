@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <polymesh/span.hh>
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+/// Voronoi diagram dual to a 2D Delaunay triangulation (counter-clockwise faces), cells clipped to a box
+/// the Voronoi vertices are the circumcenters of the faces, every cell is a counter-clockwise polygon
+/// the corners of all cells are stored in one array (CSR-like), cells updated after an insertion are appended
+/// and the storage is compacted once more than half of it is unused
+/// NOTE: like point_locator, only indices into the mesh are kept, so the mesh can be modified between updates
+struct voronoi_diagram
+{
+    voronoi_diagram(pm::vertex_attribute<tg::pos2> const& position, tg::aabb2 const& bounds);
+
+    /// recomputes all circumcenters and cells (one pass over the faces, one over the halfedges)
+    void rebuild();
+
+    /// recomputes the circumcenters of the faces around v and the cells of v and its neighbors
+    /// this is everything that changes when v was inserted by task::insert_vertex (all new faces contain v)
+    void update_around(pm::vertex_handle v);
+
+    /// recomputes the circumcenters of the faces around the given vertices and their cells
+    /// this is everything that changes when all new faces only have corners among these vertices,
+    /// e.g. after gp::remove_vertex (the vertex and its old neighbors) or gp::move_vertex (the vertex, its old and new neighbors)
+    /// removed vertices get an empty cell
+    void update_vertices(std::vector<pm::vertex_handle> const& vertices);
+
+    /// counter-clockwise cell polygon of v, empty for isolated vertices
+    pm::span<tg::pos2 const> cell(pm::vertex_handle v) const;
+
+    float cell_area(pm::vertex_handle v) const;
+
+    /// Voronoi vertex dual to f
+    tg::pos2 circumcenter(pm::face_handle f) const { return _circumcenters[f.idx.value]; }
+
+    tg::aabb2 const& bounds() const { return _bounds; }
+
+private:
+    void update_circumcenter(pm::face_handle f);
+    void update_cell(pm::vertex_handle v);
+    void resize();
+    void compact_if_sparse();
+
+    pm::Mesh const* _mesh;
+    pm::vertex_attribute<tg::pos2> const* _position;
+    tg::aabb2 _bounds;
+
+    std::vector<tg::pos2> _circumcenters; ///< per face index
+
+    std::vector<int> _cell_begin; ///< per vertex index, into _corners
+    std::vector<int> _cell_size;  ///< per vertex index
+    std::vector<tg::pos2> _corners;
+    int _unused_corners = 0; ///< corners of outdated cells
+
+    std::vector<tg::pos2> _polygon; ///< scratch space for clipping
+    std::vector<tg::pos2> _clipped;
+};
+}
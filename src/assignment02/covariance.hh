@@ -0,0 +1,130 @@
+#pragma once
+
+#include <typed-geometry/tg.hh>
+
+namespace gp
+{
+/// the 6 unique entries of a symmetric 3x3 matrix
+struct symmetric_mat3
+{
+    float xx = 0.0f;
+    float xy = 0.0f;
+    float xz = 0.0f;
+    float yy = 0.0f;
+    float yz = 0.0f;
+    float zz = 0.0f;
+};
+
+/// streaming sums of a point set from which its (unnormalized) covariance matrix can be recovered at any time
+/// positions are taken relative to the first point to keep the float sums well-conditioned
+struct covariance_accumulator
+{
+    tg::pos3 reference;
+    tg::vec3 sum = tg::vec3::zero;
+    symmetric_mat3 sum_sqr;
+    int count = 0;
+
+    void add(tg::pos3 const& p)
+    {
+        if (count == 0)
+            reference = p;
+
+        auto const d = p - reference;
+        sum += d;
+        sum_sqr.xx += d.x * d.x;
+        sum_sqr.xy += d.x * d.y;
+        sum_sqr.xz += d.x * d.z;
+        sum_sqr.yy += d.y * d.y;
+        sum_sqr.yz += d.y * d.z;
+        sum_sqr.zz += d.z * d.z;
+        ++count;
+    }
+
+    /// sum of (p - centroid)(p - centroid)^T over all points
+    symmetric_mat3 scatter() const
+    {
+        if (count == 0)
+            return {};
+
+        auto const c = sum / float(count);
+        return {sum_sqr.xx - c.x * sum.x, //
+                sum_sqr.xy - c.x * sum.y, //
+                sum_sqr.xz - c.x * sum.z, //
+                sum_sqr.yy - c.y * sum.y, //
+                sum_sqr.yz - c.y * sum.z, //
+                sum_sqr.zz - c.z * sum.z};
+    }
+};
+
+/// smallest eigenvalue of a symmetric positive semi-definite matrix (closed-form, trigonometric solution)
+inline float smallest_eigenvalue(symmetric_mat3 const& m)
+{
+    auto const off = m.xy * m.xy + m.xz * m.xz + m.yz * m.yz;
+    auto const q = (m.xx + m.yy + m.zz) / 3.0f;
+    auto const dxx = m.xx - q;
+    auto const dyy = m.yy - q;
+    auto const dzz = m.zz - q;
+    auto const p = tg::sqrt((dxx * dxx + dyy * dyy + dzz * dzz + 2.0f * off) / 6.0f);
+    if (p <= 0.0f)
+        return q; // multiple of identity
+
+    // half the determinant of (m - q I) / p
+    auto const det = dxx * (dyy * dzz - m.yz * m.yz) - m.xy * (m.xy * dzz - m.yz * m.xz) + m.xz * (m.xy * m.yz - dyy * m.xz);
+    auto const r = tg::clamp(det / (2.0f * p * p * p), -1.0f, 1.0f);
+    auto const phi = tg::acos(r) / 3.0f;
+    return q + 2.0f * p * tg::cos(phi + 120_deg);
+}
+
+/// surface variation lambda_min / (lambda_0 + lambda_1 + lambda_2) in [0, 1/3], 0 for points on a plane
+/// (Pauly et al., "Efficient Simplification of Point-Sampled Surfaces")
+inline float surface_variation(symmetric_mat3 const& m)
+{
+    auto const trace = m.xx + m.yy + m.zz;
+    return trace > 0.0f ? tg::max(0.0f, smallest_eigenvalue(m)) / trace : 0.0f;
+}
+
+/// unit eigenvector to the smallest eigenvalue of a symmetric positive semi-definite matrix
+/// for degenerate matrices (no unique smallest eigenvalue) an arbitrary valid eigenvector is returned
+inline tg::dir3 smallest_eigenvector(symmetric_mat3 const& m)
+{
+    auto const l = smallest_eigenvalue(m);
+
+    // the eigenvector is orthogonal to all rows of (m - l I), take the most stable cross product
+    auto const r0 = tg::vec3(m.xx - l, m.xy, m.xz);
+    auto const r1 = tg::vec3(m.xy, m.yy - l, m.yz);
+    auto const r2 = tg::vec3(m.xz, m.yz, m.zz - l);
+
+    auto const c01 = cross(r0, r1);
+    auto const c02 = cross(r0, r2);
+    auto const c12 = cross(r1, r2);
+    auto const l01 = length_sqr(c01);
+    auto const l02 = length_sqr(c02);
+    auto const l12 = length_sqr(c12);
+
+    auto best = c01;
+    auto best_l = l01;
+    if (l02 > best_l)
+    {
+        best = c02;
+        best_l = l02;
+    }
+    if (l12 > best_l)
+    {
+        best = c12;
+        best_l = l12;
+    }
+
+    // rows are (numerically) parallel: smallest eigenvalue has multiplicity 2, any vector orthogonal to the rows works
+    auto const row_l = tg::max(length_sqr(r0), tg::max(length_sqr(r1), length_sqr(r2)));
+    if (best_l <= 1e-12f * row_l * row_l)
+    {
+        if (row_l <= 0.0f)
+            return tg::dir3::pos_z; // multiple of identity
+
+        auto const row = length_sqr(r0) == row_l ? r0 : length_sqr(r1) == row_l ? r1 : r2;
+        return tg::any_normal(tg::normalize(row));
+    }
+
+    return tg::dir3(best / tg::sqrt(best_l));
+}
+}
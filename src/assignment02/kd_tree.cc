@@ -0,0 +1,153 @@
+#include "kd_tree.hh"
+
+#include <algorithm>
+
+#include <typed-geometry/tg.hh>
+
+gp::kd_tree::kd_tree(pm::vertex_attribute<tg::pos3> const& position, int max_leaf_size) : _mesh(&position.mesh())
+{
+    auto const n = _mesh->vertices().size();
+    _entries.reserve(n);
+    for (auto const v : _mesh->vertices())
+        _entries.push_back({position[v], int(v.idx)});
+
+    // a balanced tree with leaves of at most max_leaf_size points has less than 2n / max_leaf_size nodes
+    max_leaf_size = tg::max(1, max_leaf_size);
+    _nodes.reserve(2 * (n / max_leaf_size + 1));
+    if (n > 0)
+        build(0, n, max_leaf_size);
+}
+
+int gp::kd_tree::build(int begin, int end, int max_leaf_size)
+{
+    auto const id = int(_nodes.size());
+    _nodes.push_back({begin, end, -1, 0.0f, -1, -1});
+
+    if (end - begin <= max_leaf_size)
+        return id;
+
+    // split along the dimension of largest extent
+    auto bb = tg::aabb3(_entries[begin].pos, _entries[begin].pos);
+    for (auto i = begin + 1; i < end; ++i)
+        bb = tg::aabb_of(bb, _entries[i].pos);
+    auto const extent = bb.max - bb.min;
+    auto const dim = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+
+    // median split
+    auto const mid = begin + (end - begin) / 2;
+    std::nth_element(_entries.begin() + begin, _entries.begin() + mid, _entries.begin() + end,
+                     [&](entry const& a, entry const& b) { return a.pos[dim] < b.pos[dim]; });
+    auto const split_value = _entries[mid].pos[dim];
+
+    auto const left = build(begin, mid, max_leaf_size);
+    auto const right = build(mid, end, max_leaf_size);
+
+    auto& nd = _nodes[id];
+    nd.split_dim = dim;
+    nd.split_value = split_value;
+    nd.left = left;
+    nd.right = right;
+    return id;
+}
+
+void gp::kd_tree::search_k(int n, tg::pos3 const& p, int k, int exclude, std::vector<neighbor>& heap) const
+{
+    auto const& nd = _nodes[n];
+
+    if (nd.split_dim < 0)
+    {
+        for (auto i = nd.begin; i < nd.end; ++i)
+        {
+            auto const& e = _entries[i];
+            if (e.idx == exclude)
+                continue;
+
+            neighbor const c = {tg::distance_sqr(p, e.pos), e.idx};
+            if (int(heap.size()) < k)
+            {
+                heap.push_back(c);
+                std::push_heap(heap.begin(), heap.end());
+            }
+            else if (c < heap.front())
+            {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = c;
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+        return;
+    }
+
+    // descend into the side containing p first, then visit the other one if it can still contain closer points
+    auto const d = p[nd.split_dim] - nd.split_value;
+    auto const near_child = d < 0 ? nd.left : nd.right;
+    auto const far_child = d < 0 ? nd.right : nd.left;
+
+    search_k(near_child, p, k, exclude, heap);
+    if (int(heap.size()) < k || d * d <= heap.front().dist_sqr)
+        search_k(far_child, p, k, exclude, heap);
+}
+
+void gp::kd_tree::search_radius(int n, tg::pos3 const& p, float radius_sqr, int exclude, std::vector<neighbor>& result) const
+{
+    auto const& nd = _nodes[n];
+
+    if (nd.split_dim < 0)
+    {
+        for (auto i = nd.begin; i < nd.end; ++i)
+        {
+            auto const& e = _entries[i];
+            auto const dist_sqr = tg::distance_sqr(p, e.pos);
+            if (dist_sqr <= radius_sqr && e.idx != exclude)
+                result.push_back({dist_sqr, e.idx});
+        }
+        return;
+    }
+
+    auto const d = p[nd.split_dim] - nd.split_value;
+    if (d < 0 || d * d <= radius_sqr)
+        search_radius(nd.left, p, radius_sqr, exclude, result);
+    if (d >= 0 || d * d <= radius_sqr)
+        search_radius(nd.right, p, radius_sqr, exclude, result);
+}
+
+void gp::kd_tree::write_result(std::vector<neighbor> const& neighbors, std::vector<pm::vertex_handle>& result) const
+{
+    result.resize(neighbors.size());
+    for (auto i = 0u; i < neighbors.size(); ++i)
+        result[i] = _mesh->vertices()[pm::vertex_index(neighbors[i].idx)];
+}
+
+void gp::kd_tree::k_nearest(tg::pos3 const& p, int k, std::vector<pm::vertex_handle>& result, pm::vertex_handle exclude) const
+{
+    std::vector<neighbor> neighbors;
+    k_nearest(p, k, neighbors, exclude.idx.value);
+    write_result(neighbors, result);
+}
+
+void gp::kd_tree::within_radius(tg::pos3 const& p, float radius, std::vector<pm::vertex_handle>& result, pm::vertex_handle exclude) const
+{
+    std::vector<neighbor> neighbors;
+    within_radius(p, radius, neighbors, exclude.idx.value);
+    write_result(neighbors, result);
+}
+
+void gp::kd_tree::k_nearest(tg::pos3 const& p, int k, std::vector<neighbor>& result, int exclude) const
+{
+    result.clear();
+    if (_nodes.empty() || k <= 0)
+        return;
+
+    search_k(0, p, k, exclude, result);
+    std::sort(result.begin(), result.end());
+}
+
+void gp::kd_tree::within_radius(tg::pos3 const& p, float radius, std::vector<neighbor>& result, int exclude) const
+{
+    result.clear();
+    if (_nodes.empty() || radius < 0)
+        return;
+
+    search_radius(0, p, radius * radius, exclude, result);
+    std::sort(result.begin(), result.end());
+}
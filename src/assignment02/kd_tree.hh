@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+/// static kd-tree over the vertex positions of a (point cloud) mesh
+/// NOTE: the tree stores a copy of the positions, rebuild it when the positions change
+struct kd_tree
+{
+    /// query result without handle construction
+    struct neighbor
+    {
+        float dist_sqr;
+        int idx; ///< vertex index
+
+        bool operator<(neighbor const& rhs) const { return dist_sqr < rhs.dist_sqr || (dist_sqr == rhs.dist_sqr && idx < rhs.idx); }
+    };
+
+    explicit kd_tree(pm::vertex_attribute<tg::pos3> const& position, int max_leaf_size = 16);
+
+    /// writes the k nearest vertices to p into result, sorted by increasing distance (ties by index)
+    /// vertex "exclude" is skipped (e.g. the query vertex itself)
+    void k_nearest(tg::pos3 const& p, int k, std::vector<pm::vertex_handle>& result, pm::vertex_handle exclude = {}) const;
+
+    /// writes all vertices with distance <= radius to p into result, sorted by increasing distance (ties by index)
+    void within_radius(tg::pos3 const& p, float radius, std::vector<pm::vertex_handle>& result, pm::vertex_handle exclude = {}) const;
+
+    /// same as above, but reports vertex indices and squared distances (exclude is a vertex index, -1 for none)
+    void k_nearest(tg::pos3 const& p, int k, std::vector<neighbor>& result, int exclude = -1) const;
+    void within_radius(tg::pos3 const& p, float radius, std::vector<neighbor>& result, int exclude = -1) const;
+
+    pm::Mesh const& mesh() const { return *_mesh; }
+    int size() const { return int(_entries.size()); }
+
+private:
+    struct entry
+    {
+        tg::pos3 pos;
+        int idx; ///< vertex index
+    };
+
+    struct node
+    {
+        int begin;     ///< first point of this subtree
+        int end;       ///< one past the last point of this subtree
+        int split_dim; ///< -1 for leaves
+        float split_value;
+        int left;
+        int right;
+    };
+
+    int build(int begin, int end, int max_leaf_size);
+
+    void search_k(int n, tg::pos3 const& p, int k, int exclude, std::vector<neighbor>& heap) const;
+    void search_radius(int n, tg::pos3 const& p, float radius_sqr, int exclude, std::vector<neighbor>& result) const;
+
+    void write_result(std::vector<neighbor> const& neighbors, std::vector<pm::vertex_handle>& result) const;
+
+    pm::Mesh const* _mesh;
+    std::vector<entry> _entries; ///< points in tree order
+    std::vector<node> _nodes;    ///< _nodes[0] is the root
+};
+}
@@ -1,6 +1,13 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <queue>
+#include <string>
 
 #include <imgui/imgui.h>
 #include <glow-extras/glfw/GlfwContext.hh>
@@ -10,30 +17,24 @@
 #include <polymesh/formats.hh>
 #include <typed-geometry/tg.hh>
 
+#include <common/thread_pool.hh>
+#include <common/trace.hh>
+
+#include "kd_tree.hh"
+#include "mst.hh"
+#include "neighbor_graph.hh"
+#include "out_of_core.hh"
+#include "space_filling_curve.hh"
 #include "task.hh"
+#include "uniform_grid.hh"
 
 namespace gp
 {
-std::vector<pm::vertex_handle> k_nearest_neighbors(pm::vertex_handle v, pm::vertex_attribute<tg::pos3> const& position, int k)
+enum neighborhood_type
 {
-    auto const safe_k = tg::min(k, position.mesh().vertices().size());
-
-    // all vertices
-    auto neighbors = v.mesh->vertices().to_vector();
-
-    // remove v from its neighbors
-    neighbors.erase(std::remove(neighbors.begin(), neighbors.end(), v), neighbors.end());
-
-    // sort by distance from v
-    std::partial_sort(neighbors.begin(), neighbors.begin() + safe_k, neighbors.end(), [&](pm::vertex_handle v0, pm::vertex_handle v1) {
-        return tg::distance_sqr(position[v], position[v0]) < tg::distance_sqr(position[v], position[v1]);
-    });
-
-    // keep only k
-    neighbors.resize(safe_k);
-
-    return neighbors;
-}
+    nearest_neighbors = 0,
+    fixed_radius
+};
 
 void propagate_orientation(pm::vertex_handle v_from, pm::vertex_handle v_to, pm::vertex_attribute<tg::dir3>& normal)
 {
@@ -42,7 +43,7 @@ void propagate_orientation(pm::vertex_handle v_from, pm::vertex_handle v_to, pm:
         normal[v_to] = -normal[v_to];
 }
 
-void propagate_orientation(pm::vertex_attribute<tg::pos3> const& position, int k, pm::vertex_handle seed, pm::vertex_attribute<tg::dir3>& normal, std::vector<std::pair<pm::vertex_handle,pm::vertex_handle>>& spanning_tree_edges)
+void propagate_orientation(pm::vertex_attribute<tg::pos3> const& position, neighbor_graph const& neighbors, pm::vertex_handle seed, pm::vertex_attribute<tg::dir3>& normal, std::vector<std::pair<pm::vertex_handle,pm::vertex_handle>>& spanning_tree_edges)
 {
     // candidate edges in the minimum spanning tree
     struct propagation_candidate
@@ -52,7 +53,15 @@ void propagate_orientation(pm::vertex_attribute<tg::pos3> const& position, int k
         float edge_weight;
         // std::priority_queue takes the largest element by default.
         // Since we want the edge with the minimal weight, we need to invert the comparison!
-        bool operator<(propagation_candidate const& rhs) const { return edge_weight > rhs.edge_weight; }
+        // Ties are broken by the (smaller, larger) vertex index pair so that the tree is unique.
+        bool operator<(propagation_candidate const& rhs) const
+        {
+            if (edge_weight != rhs.edge_weight)
+                return edge_weight > rhs.edge_weight;
+            return edge_key() > rhs.edge_key();
+        }
+
+        std::pair<int, int> edge_key() const { return std::minmax(v_from.idx.value, v_to.idx.value); }
     };
 
     auto const& mesh = position.mesh();
@@ -60,11 +69,6 @@ void propagate_orientation(pm::vertex_attribute<tg::pos3> const& position, int k
     // visited flag. Each vertex should be visited only once
     auto visited = mesh.vertices().make_attribute(false);
 
-    // initialize nearest neighbor graph
-    pm::vertex_attribute<std::vector<pm::vertex_handle>> neighbors(mesh);
-    for (auto const v : position.mesh().vertices())
-        neighbors[v] = k_nearest_neighbors(v, position, k);
-
     // priority queue to build the minimum spanning tree
     std::priority_queue<propagation_candidate> q;
 
@@ -90,8 +94,9 @@ void propagate_orientation(pm::vertex_attribute<tg::pos3> const& position, int k
         spanning_tree_edges.push_back({current.v_from, current.v_to});
 
         // add neighbors to priority queue
-        for (auto const& neighbor : neighbors[current.v_to])
+        for (auto const idx : neighbors.neighbors_of(current.v_to))
         {
+            auto const neighbor = mesh.vertices()[pm::vertex_index(idx)];
             // only visit each vertex once
             if (!visited[neighbor])
             {
@@ -102,22 +107,281 @@ void propagate_orientation(pm::vertex_attribute<tg::pos3> const& position, int k
 }
 
 
-void estimate_normals(pm::Mesh const& mesh, pm::vertex_attribute<tg::pos3> const& position, int k, pm::vertex_attribute<tg::dir3>& normal)
+/// computes the same spanning tree as propagate_orientation above (the neighbor graph must be symmetric),
+/// but all edge weights are computed once, the tree is built with parallel Boruvka,
+/// and the orientation is then propagated by a breadth-first traversal of the tree from the seed
+void propagate_orientation_parallel(pm::vertex_attribute<tg::pos3> const& position,
+                                    neighbor_graph const& neighbors,
+                                    pm::vertex_handle seed,
+                                    pm::vertex_attribute<tg::dir3>& normal,
+                                    std::vector<std::pair<pm::vertex_handle, pm::vertex_handle>>& spanning_tree_edges)
+{
+    auto const& mesh = position.mesh();
+    auto const n = neighbors.size();
+
+    // weights are invariant under normal flips, so they can all be computed up front
+    auto edges = undirected_edges(neighbors);
+    thread_pool::global().parallel_for(int(edges.size()), 4096, [&](int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const v0 = mesh.vertices()[pm::vertex_index(edges[i].v0)];
+            auto const v1 = mesh.vertices()[pm::vertex_index(edges[i].v1)];
+            edges[i].weight = task::compute_mst_weight(v0, v1, position, normal);
+        }
+    });
+
+    auto const forest = minimum_spanning_forest(n, edges);
+
+    // adjacency of the forest
+    std::vector<int> offsets(n + 1, 0);
+    for (auto const ei : forest)
+    {
+        ++offsets[edges[ei].v0 + 1];
+        ++offsets[edges[ei].v1 + 1];
+    }
+    for (auto v = 0; v < n; ++v)
+        offsets[v + 1] += offsets[v];
+    std::vector<int> adjacent(offsets[n]);
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (auto const ei : forest)
+    {
+        adjacent[fill[edges[ei].v0]++] = edges[ei].v1;
+        adjacent[fill[edges[ei].v1]++] = edges[ei].v0;
+    }
+
+    // breadth-first propagation from the seed
+    auto visited = mesh.vertices().make_attribute(false);
+    std::vector<pm::vertex_handle> queue = {seed};
+    visited[seed] = true;
+
+    spanning_tree_edges.clear();
+    for (auto head = 0u; head < queue.size(); ++head)
+    {
+        auto const v = queue[head];
+        for (auto i = offsets[v.idx.value]; i < offsets[v.idx.value + 1]; ++i)
+        {
+            auto const w = mesh.vertices()[pm::vertex_index(adjacent[i])];
+            if (visited[w])
+                continue;
+
+            visited[w] = true;
+            propagate_orientation(v, w, normal);
+            spanning_tree_edges.push_back({v, w});
+            queue.push_back(w);
+        }
+    }
+}
+
+/// called with the number of processed vertices and the total number of vertices
+using progress_callback = std::function<void(int, int)>;
+
+/// estimates an (unoriented) normal per vertex from its neighborhood
+/// min_k > 0 selects the adaptive mode, see task::compute_normals_adaptive
+/// the neighborhoods are independent, so the parallel version gives exactly the same result as the serial one
+/// progress is reported at most every 250ms and once at the end
+void estimate_normals(pm::vertex_attribute<tg::pos3> const& position,
+                      neighbor_graph const& neighbors,
+                      pm::vertex_attribute<tg::dir3>& normal,
+                      int min_k = 0,
+                      bool parallel = true,
+                      progress_callback const& progress = {})
+{
+    auto const n = neighbors.size();
+    auto const chunk_size = 1024;
+
+    std::atomic<int> done = 0;
+    std::mutex progress_mutex;
+    auto last_report = std::chrono::steady_clock::now();
+
+    GP_TRACE(trace::info, "[normals] estimating {} normals (min_k {}, parallel {})", n, min_k, parallel);
+
+    auto const estimate_chunk = [&](int begin, int end) {
+        GP_TRACE(trace::debug, "[normals] vertices {} to {}", begin, end);
+        if (min_k > 0)
+            task::compute_normals_adaptive(neighbors, begin, end, min_k, position, normal);
+        else
+            task::compute_normals(neighbors, begin, end, position, normal);
+
+        auto const done_now = done += end - begin;
+        if (!progress)
+            return;
+
+        // only one thread reports, the others just continue
+        std::unique_lock<std::mutex> lock(progress_mutex, std::try_to_lock);
+        auto const now = std::chrono::steady_clock::now();
+        if (lock.owns_lock() && done_now < n && now - last_report >= std::chrono::milliseconds(250))
+        {
+            last_report = now;
+            progress(done_now, n);
+        }
+    };
+
+    if (parallel)
+        thread_pool::global().parallel_for(n, chunk_size, estimate_chunk);
+    else
+        for (auto begin = 0; begin < n; begin += chunk_size)
+            estimate_chunk(begin, tg::min(begin + chunk_size, n));
+
+    if (progress)
+        progress(n, n);
+}
+
+/// cache misses when reading the positions of all neighborhoods in vertex order (as estimate_normals does),
+/// simulated for a 32 KiB, 8-way set-associative LRU cache with 64 byte lines
+std::int64_t simulated_cache_misses(neighbor_graph const& neighbors)
+{
+    constexpr int ways = 8;
+    constexpr int sets = 32 * 1024 / 64 / ways;
+
+    std::vector<std::int64_t> lines(sets * ways, -1); // per set, most recently used first
+    std::int64_t misses = 0;
+    for (auto v = 0; v < neighbors.size(); ++v)
+        for (auto const w : neighbors.neighbors_of(v))
+        {
+            auto const line = std::int64_t(w) * std::int64_t(sizeof(tg::pos3)) / 64;
+            auto const set = lines.begin() + (line % sets) * ways;
+            auto hit = std::find(set, set + ways, line);
+            if (hit == set + ways)
+            {
+                ++misses;
+                --hit; // evict the least recently used line
+            }
+            std::rotate(set, hit, hit + 1);
+            *set = line;
+        }
+    return misses;
+}
+
+/// times the normal pipeline (neighborhoods, normals, orientation) for the input order and both space-filling curves
+void benchmark_layouts(std::string const& filename)
 {
-    auto count = 0;
-    for (auto const v : mesh.vertices())
+    char const* names[] = {"input", "morton", "hilbert"};
+    double base_seconds = 0;
+    std::int64_t base_misses = 0;
+
+    for (auto layout = 0; layout < 3; ++layout)
     {
-        auto const neighbors = k_nearest_neighbors(v, position, k);
-        normal[v] = task::compute_normal(neighbors, position);
+        pm::Mesh mesh;
+        pm::vertex_attribute<tg::pos3> position(mesh);
+        if (!pm::load(filename, mesh, position))
+        {
+            std::cerr << "could not load " << filename << std::endl;
+            return;
+        }
+        pm::normalize(position);
 
-        // report progress
-        std::cout << "vertex " << ++count << " of " << mesh.vertices().size() << std::endl;
+        auto const start = std::chrono::steady_clock::now();
+        if (layout > 0)
+            sort_along_curve(mesh, position, layout == 1 ? curve_type::morton : curve_type::hilbert);
+
+        auto const neighbors = neighbor_graph::k_nearest(kd_tree(position), position, 10);
+        pm::vertex_attribute<tg::dir3> normal(mesh);
+        estimate_normals(position, neighbors, normal);
+        std::vector<std::pair<pm::vertex_handle, pm::vertex_handle>> spanning_tree_edges;
+        propagate_orientation_parallel(position, neighbors.symmetrized(), mesh.vertices().first(), normal, spanning_tree_edges);
+        auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        auto const misses = simulated_cache_misses(neighbors);
+        if (layout == 0)
+        {
+            base_seconds = seconds;
+            base_misses = misses;
+        }
+
+        std::cout << names[layout] << ": " << seconds * 1000 << " ms (speedup " << base_seconds / seconds << "), " //
+                  << misses << " simulated cache misses (" << 100.0 * double(misses) / double(tg::max(base_misses, std::int64_t(1))) << "%)" << std::endl;
+    }
+}
+
+/// builds a kd_tree over 100000, 1000000, ... up to max_points uniformly random points in the unit cube and queries
+/// the 10 nearest neighbors of every point (serially), reports the times per n log2 n, which stay flat for O(n log n)
+/// the queries run once in random (input) order and once in Morton order: in random order every query touches
+/// other nodes than the one before, so at large n the cache misses dominate, in Morton order only the algorithm counts
+void benchmark_kd_tree(int max_points)
+{
+    for (auto n = 100000; n <= max_points; n *= 10)
+    {
+        tg::rng rng;
+        pm::Mesh mesh;
+        pm::vertex_attribute<tg::pos3> position(mesh);
+        for (auto i = 0; i < n; ++i)
+            position[mesh.vertices().add()] = tg::uniform(rng, tg::aabb3(tg::pos3(0), tg::pos3(1)));
+
+        // query order along the Morton curve (layout is [current index] = position along the curve)
+        auto const layout = space_filling_curve_layout(position, curve_type::morton);
+        std::vector<int> morton_order(n);
+        for (auto i = 0; i < n; ++i)
+            morton_order[layout[i]] = i;
+
+        auto const t0 = std::chrono::steady_clock::now();
+        kd_tree const tree(position);
+        auto const t1 = std::chrono::steady_clock::now();
+        std::vector<kd_tree::neighbor> result;
+        for (auto i = 0; i < n; ++i)
+            tree.k_nearest(position[pm::vertex_index(i)], 10, result, i);
+        auto const t2 = std::chrono::steady_clock::now();
+        for (auto const i : morton_order)
+            tree.k_nearest(position[pm::vertex_index(i)], 10, result, i);
+        auto const t3 = std::chrono::steady_clock::now();
+
+        auto const n_log_n = double(n) * std::log2(double(n));
+        auto const build_seconds = std::chrono::duration<double>(t1 - t0).count();
+        auto const random_seconds = std::chrono::duration<double>(t2 - t1).count();
+        auto const morton_seconds = std::chrono::duration<double>(t3 - t2).count();
+        std::cout << n << " points: build " << build_seconds * 1000 << " ms (" << build_seconds * 1e9 / n_log_n << " ns per n log n), " //
+                  << "10-NN of all points in random order " << random_seconds * 1000 << " ms (" << random_seconds * 1e9 / n_log_n
+                  << " ns per n log n), in Morton order " << morton_seconds * 1000 << " ms (" << morton_seconds * 1e9 / n_log_n
+                  << " ns per n log n)" << std::endl;
     }
 }
 }
 
-int main(int /*argc*/, char** /*args*/)
+int main(int argc, char** args)
 {
+    // batch mode for point clouds that do not fit into memory:
+    //   --convert <mesh file> <point file>
+    //   --out-of-core <point file> <normal file> [memory budget in MB]
+    //   --benchmark-layout <mesh file>
+    //   --benchmark-kdtree [max #points]
+    if (argc >= 4 && std::string(args[1]) == "--convert")
+    {
+        pm::Mesh mesh;
+        pm::vertex_attribute<tg::pos3> position(mesh);
+        if (!pm::load(args[2], mesh, position) || !gp::write_point_file(args[3], position))
+        {
+            std::cerr << "could not convert " << args[2] << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc >= 3 && std::string(args[1]) == "--benchmark-layout")
+    {
+        gp::benchmark_layouts(args[2]);
+        return 0;
+    }
+    if (argc >= 2 && std::string(args[1]) == "--benchmark-kdtree")
+    {
+        gp::benchmark_kd_tree(argc >= 3 ? std::stoi(args[2]) : 10000000);
+        return 0;
+    }
+    if (argc >= 4 && std::string(args[1]) == "--out-of-core")
+    {
+        gp::out_of_core_settings settings;
+        if (argc >= 5)
+            settings.memory_budget = std::size_t(std::stoull(args[4])) << 20;
+        settings.progress = [](int i, int n) { std::cout << "tile " << i << " of " << n << std::endl; };
+
+        gp::out_of_core_stats stats;
+        if (!gp::estimate_normals_out_of_core(args[2], args[3], settings, stats))
+        {
+            std::cerr << "out-of-core normal estimation failed" << std::endl;
+            return 1;
+        }
+        std::cout << stats.num_points << " points in " << stats.num_tiles << " tiles, " << stats.num_passes << " passes, "
+                  << stats.uncertain_points << " points with neighbors possibly outside of the halo" << std::endl;
+        return 0;
+    }
+
     // used for rendering
     glow::glfw::GlfwContext ctx;
 
@@ -128,12 +392,26 @@ int main(int /*argc*/, char** /*args*/)
     pm::vertex_attribute<tg::dir3> normal(mesh);
     // the k in k-nearest-neighbors
     int const k = 10;
+    // adaptive k: per point, the neighborhood size in [min_k, max_k] with the lowest surface variation is used
+    bool adaptive_k = false;
+    int const min_k = 6;
+    int const max_k = 30;
+    // the radius of fixed-radius neighborhoods (positions are normalized)
+    float radius = 0.05f;
+    float const min_radius = 1e-3f;
+    float const max_radius = 0.5f;
+    gp::neighborhood_type neighborhood = gp::neighborhood_type::nearest_neighbors;
 
     // where to start spanning tree
     pm::vertex_handle seed;
 
     tg::aabb3 aabb;
 
+    // k nearest neighbors of every point, shared by normal estimation and orientation propagation
+    gp::neighbor_graph neighbors;
+    // symmetric version used for the minimum spanning tree
+    gp::neighbor_graph riemannian_graph;
+
     std::vector<std::pair<pm::vertex_handle,pm::vertex_handle>> spanning_tree_edges;
 
     // folders to search for data
@@ -143,6 +421,18 @@ int main(int /*argc*/, char** /*args*/)
 
     char const* filenames[] = {"sphere.off", "tetra_thing.off"};
 
+    auto const build_neighbors = [&]() {
+        if (neighborhood == gp::neighborhood_type::fixed_radius)
+        {
+            // cells of at least the radius, so every query visits at most 27 cells
+            auto const cell_size = tg::max(gp::uniform_grid::default_cell_size(position), radius);
+            neighbors = gp::neighbor_graph::within_radius(gp::uniform_grid(position, cell_size), position, radius);
+        }
+        else
+            neighbors = gp::neighbor_graph::k_nearest(gp::kd_tree(position), position, adaptive_k ? max_k : k);
+        riemannian_graph = neighbors.symmetrized();
+    };
+
     auto const load = [&](std::string const& filename) {
         mesh.clear();
         if (!pm::load(folders[0] + filename, mesh, position) && //
@@ -153,7 +443,10 @@ int main(int /*argc*/, char** /*args*/)
             exit(1);
         }
         pm::normalize(position);
+        // neighboring points close in memory
+        gp::sort_along_curve(mesh, position, gp::curve_type::morton);
         aabb = tg::aabb_of(position);
+        build_neighbors();
         seed = mesh.vertices().first();
     };
     load(filenames[0]);
@@ -164,9 +457,13 @@ int main(int /*argc*/, char** /*args*/)
     bool spanning_tree_computed = false;
     bool show_normals = true;
     bool show_spanning_tree = false;
+    bool parallel_mst = true;
+    const char* neighborhood_names[] = {"k nearest", "radius"};
     std::vector<tg::segment3> normal_segments;
     std::vector<tg::segment3> spanning_tree_segments;
 
+    auto const report_progress = [](int done, int total) { std::cout << "vertex " << done << " of " << total << std::endl; };
+
     auto const compute_normal_segments = [&]() {
         normal_segments.clear();
         for (auto const v : mesh.vertices())
@@ -187,11 +484,24 @@ int main(int /*argc*/, char** /*args*/)
     gv::interactive([&](auto) {
         ImGui::Begin("Normal Estimation");
         auto data_changed = ImGui::Combo("Data", &current_item, filenames, 2);
+        auto neighborhood_changed = ImGui::Combo("Neighborhood", reinterpret_cast<int*>(&neighborhood), neighborhood_names, 2);
+        if (neighborhood == gp::neighborhood_type::fixed_radius)
+        {
+            neighborhood_changed |= ImGui::InputFloat("Radius", &radius);
+            radius = tg::clamp(radius, min_radius, max_radius);
+        }
+        neighborhood_changed |= ImGui::Checkbox("Adaptive k", &adaptive_k);
+        if (neighborhood_changed && !data_changed)
+        {
+            build_neighbors();
+            normals_computed = false;
+            spanning_tree_computed = false;
+        }
         auto normals_changed = false;
         if (ImGui::Button("Compute Normals"))
         {
             std::cout << "Estimating normals" << std::endl;
-            gp::estimate_normals(mesh, position, k, normal);
+            gp::estimate_normals(position, neighbors, normal, adaptive_k ? min_k : 0, true, report_progress);
             compute_normal_segments();
             normals_computed = true;
             normals_changed = true;
@@ -203,7 +513,7 @@ int main(int /*argc*/, char** /*args*/)
             if (!normals_computed)
             {
                 std::cout << "Estimating normals" << std::endl;
-                gp::estimate_normals(mesh, position, k, normal);
+                gp::estimate_normals(position, neighbors, normal, adaptive_k ? min_k : 0, true, report_progress);
                 compute_normal_segments();
                 normals_computed = true;
             }
@@ -218,7 +528,10 @@ int main(int /*argc*/, char** /*args*/)
             if (normal[seed].x > 0.0f)
                 normal[seed] = -normal[seed];
 
-            gp::propagate_orientation(position, k, seed, normal, spanning_tree_edges);
+            if (parallel_mst)
+                gp::propagate_orientation_parallel(position, riemannian_graph, seed, normal, spanning_tree_edges);
+            else
+                gp::propagate_orientation(position, riemannian_graph, seed, normal, spanning_tree_edges);
 
             compute_normal_segments();
             normals_changed = true;
@@ -230,6 +543,9 @@ int main(int /*argc*/, char** /*args*/)
             gv::configure(*spanning_tree_r, tg::color3::green);
             spanning_tree_computed = true;
         }
+        ImGui::Checkbox("Parallel MST", &parallel_mst);
+        if (ImGui::Button("Dump Trace"))
+            gp::trace::dump(std::cout);
         bool something_changed = ImGui::Checkbox("Show normals", &show_normals);
         something_changed |= ImGui::Checkbox("Show Spanning Tree", &show_spanning_tree);
         ImGui::End();
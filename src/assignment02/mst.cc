@@ -0,0 +1,151 @@
+#include "mst.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include <common/thread_pool.hh>
+
+#include "neighbor_graph.hh"
+
+namespace
+{
+// maps a float to an unsigned integer with the same ordering (also for negative values)
+std::uint32_t orderable_bits(float f)
+{
+    if (f == 0.0f)
+        f = 0.0f; // -0 and +0 compare equal
+    std::uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+void atomic_min(std::atomic<std::uint64_t>& target, std::uint64_t value)
+{
+    auto current = target.load(std::memory_order_relaxed);
+    while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+}
+
+std::vector<gp::weighted_edge> gp::undirected_edges(neighbor_graph const& symmetric_graph)
+{
+    auto const n = symmetric_graph.size();
+
+    // rows are sorted, so the edges with v < w form a suffix of every row
+    std::vector<int> offsets(n + 1, 0);
+    for (auto v = 0; v < n; ++v)
+    {
+        auto count = 0;
+        for (auto const w : symmetric_graph.neighbors_of(v))
+            count += w > v;
+        offsets[v + 1] = offsets[v] + count;
+    }
+
+    std::vector<weighted_edge> edges(offsets[n]);
+    thread_pool::global().parallel_for(n, 4096, [&](int begin, int end) {
+        for (auto v = begin; v < end; ++v)
+        {
+            auto e = offsets[v];
+            for (auto const w : symmetric_graph.neighbors_of(v))
+                if (w > v)
+                    edges[e++] = {v, w, 0.0f};
+        }
+    });
+
+    return edges;
+}
+
+std::vector<int> gp::minimum_spanning_forest(int num_vertices, std::vector<weighted_edge> const& edges)
+{
+    auto& pool = thread_pool::global();
+    auto const chunk_size = 4096;
+    auto const none = std::numeric_limits<std::uint64_t>::max();
+
+    // union-find with union by size, finds without path compression are safe to run concurrently
+    std::vector<int> parent(num_vertices);
+    std::vector<int> size(num_vertices, 1);
+    for (auto v = 0; v < num_vertices; ++v)
+        parent[v] = v;
+    auto const find = [&](int v) {
+        while (parent[v] != v)
+            v = parent[v];
+        return v;
+    };
+
+    // component label of every vertex, refreshed after each round
+    std::vector<int> component = parent;
+
+    // candidate edges (indices into edges) that still connect different components
+    std::vector<int> candidates(edges.size());
+    for (auto i = 0u; i < edges.size(); ++i)
+        candidates[i] = int(i);
+
+    // lightest edge leaving each component, encoded as (weight bits, edge index)
+    std::vector<std::atomic<std::uint64_t>> lightest(num_vertices);
+    for (auto& l : lightest)
+        l.store(none, std::memory_order_relaxed);
+
+    std::vector<int> forest;
+    while (!candidates.empty())
+    {
+        pool.parallel_for(int(candidates.size()), chunk_size, [&](int begin, int end) {
+            for (auto i = begin; i < end; ++i)
+            {
+                auto const& e = edges[candidates[i]];
+                auto const c0 = component[e.v0];
+                auto const c1 = component[e.v1];
+                if (c0 == c1)
+                    continue;
+
+                auto const key = (std::uint64_t(orderable_bits(e.weight)) << 32) | std::uint32_t(candidates[i]);
+                atomic_min(lightest[c0], key);
+                atomic_min(lightest[c1], key);
+            }
+        });
+
+        // merge along the selected edges, an edge selected by both of its components is only added once
+        auto merged = false;
+        for (auto c = 0; c < num_vertices; ++c)
+        {
+            auto const key = lightest[c].load(std::memory_order_relaxed);
+            if (key == none)
+                continue;
+            lightest[c].store(none, std::memory_order_relaxed);
+
+            auto const ei = int(key & 0xFFFFFFFFu);
+            auto r0 = find(edges[ei].v0);
+            auto r1 = find(edges[ei].v1);
+            if (r0 == r1)
+                continue;
+
+            if (size[r0] < size[r1])
+                std::swap(r0, r1);
+            parent[r1] = r0;
+            size[r0] += size[r1];
+            forest.push_back(ei);
+            merged = true;
+        }
+
+        if (!merged)
+            break;
+
+        pool.parallel_for(num_vertices, chunk_size, [&](int begin, int end) {
+            for (auto v = begin; v < end; ++v)
+                component[v] = find(v);
+        });
+
+        // drop edges inside components
+        auto write = 0u;
+        for (auto const ei : candidates)
+            if (component[edges[ei].v0] != component[edges[ei].v1])
+                candidates[write++] = ei;
+        candidates.resize(write);
+    }
+
+    std::sort(forest.begin(), forest.end());
+    return forest;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+namespace gp
+{
+struct neighbor_graph;
+
+/// undirected edge between two vertex indices
+struct weighted_edge
+{
+    int v0;
+    int v1;
+    float weight;
+};
+
+/// one edge (v, w) with v < w per neighbor pair of a symmetric graph (see neighbor_graph::symmetrized), ordered by (v, w)
+/// weights are initialized to zero
+std::vector<weighted_edge> undirected_edges(neighbor_graph const& symmetric_graph);
+
+/// minimum spanning forest via parallel Boruvka
+/// edges are totally ordered by (weight, position in edges), so the result is unique and equals that of Prim or Kruskal with the same tie rule
+/// returns the indices of the forest edges in increasing order
+std::vector<int> minimum_spanning_forest(int num_vertices, std::vector<weighted_edge> const& edges);
+}
@@ -0,0 +1,217 @@
+#include "neighbor_graph.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include <typed-geometry/tg.hh>
+
+#include <common/thread_pool.hh>
+
+#include "kd_tree.hh"
+#include "uniform_grid.hh"
+
+namespace
+{
+// file layout: magic, version, #vertices, #neighbors, has distances, offsets, neighbors, [distances]
+constexpr char file_magic[4] = {'G', 'P', 'N', 'G'};
+constexpr std::int32_t file_version = 1;
+
+template <class T>
+void write_array(std::ofstream& out, std::vector<T> const& data)
+{
+    out.write(reinterpret_cast<char const*>(data.data()), std::streamsize(data.size() * sizeof(T)));
+}
+
+template <class T>
+bool read_array(std::ifstream& in, std::vector<T>& data, std::int64_t size)
+{
+    data.resize(size_t(size));
+    in.read(reinterpret_cast<char*>(data.data()), std::streamsize(data.size() * sizeof(T)));
+    return bool(in);
+}
+}
+
+gp::neighbor_graph gp::neighbor_graph::k_nearest(kd_tree const& tree, pm::vertex_attribute<tg::pos3> const& position, int k, bool store_distances)
+{
+    auto const& mesh = position.mesh();
+    auto const n = mesh.all_vertices().size();
+
+    // every valid vertex gets exactly min(k, #vertices - 1) neighbors, so the rows can be laid out up front
+    auto const row_size = tg::max(0, tg::min(k, tree.size() - 1));
+
+    neighbor_graph g;
+    g.offsets.resize(n + 1);
+    g.offsets[0] = 0;
+    for (auto i = 0; i < n; ++i)
+        g.offsets[i + 1] = g.offsets[i] + (mesh.vertices()[pm::vertex_index(i)].is_removed() ? 0 : row_size);
+
+    g.neighbors.resize(g.offsets[n]);
+    if (store_distances)
+        g.distances_sqr.resize(g.offsets[n]);
+
+    thread_pool::global().parallel_for(n, 1024, [&](int begin, int end) {
+        std::vector<kd_tree::neighbor> result;
+        for (auto i = begin; i < end; ++i)
+        {
+            if (g.offsets[i] == g.offsets[i + 1])
+                continue;
+
+            tree.k_nearest(position[pm::vertex_index(i)], k, result, i);
+            for (auto j = 0; j < row_size; ++j)
+            {
+                g.neighbors[g.offsets[i] + j] = result[j].idx;
+                if (store_distances)
+                    g.distances_sqr[g.offsets[i] + j] = result[j].dist_sqr;
+            }
+        }
+    });
+
+    return g;
+}
+
+gp::neighbor_graph gp::neighbor_graph::within_radius(uniform_grid const& grid, pm::vertex_attribute<tg::pos3> const& position, float radius, bool store_distances)
+{
+    auto const n = position.mesh().all_vertices().size();
+    auto const& order = grid.morton_order();
+
+    // rows have different lengths: count first, then fill
+    neighbor_graph g;
+    g.offsets.assign(n + 1, 0);
+    thread_pool::global().parallel_for(int(order.size()), 1024, [&](int begin, int end) {
+        std::vector<kd_tree::neighbor> result;
+        for (auto i = begin; i < end; ++i)
+        {
+            grid.within_radius(position[pm::vertex_index(order[i])], radius, result, order[i]);
+            g.offsets[order[i] + 1] = int(result.size());
+        }
+    });
+    for (auto i = 0; i < n; ++i)
+        g.offsets[i + 1] += g.offsets[i];
+
+    g.neighbors.resize(g.offsets[n]);
+    if (store_distances)
+        g.distances_sqr.resize(g.offsets[n]);
+
+    thread_pool::global().parallel_for(int(order.size()), 1024, [&](int begin, int end) {
+        std::vector<kd_tree::neighbor> result;
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const v = order[i];
+            grid.within_radius(position[pm::vertex_index(v)], radius, result, v);
+            for (auto j = 0; j < int(result.size()); ++j)
+            {
+                g.neighbors[g.offsets[v] + j] = result[j].idx;
+                if (store_distances)
+                    g.distances_sqr[g.offsets[v] + j] = result[j].dist_sqr;
+            }
+        }
+    });
+
+    return g;
+}
+
+gp::neighbor_graph gp::neighbor_graph::symmetrized() const
+{
+    auto const n = size();
+
+    // every directed edge (v, w) is inserted as (v, w) and (w, v)
+    std::vector<int> degree(n, 0);
+    for (auto v = 0; v < n; ++v)
+        for (auto const w : neighbors_of(v))
+        {
+            ++degree[v];
+            ++degree[w];
+        }
+
+    neighbor_graph g;
+    g.offsets.resize(n + 1);
+    g.offsets[0] = 0;
+    for (auto v = 0; v < n; ++v)
+        g.offsets[v + 1] = g.offsets[v] + degree[v];
+
+    g.neighbors.resize(g.offsets[n]);
+    std::vector<int> fill(g.offsets.begin(), g.offsets.end() - 1);
+    for (auto v = 0; v < n; ++v)
+        for (auto const w : neighbors_of(v))
+        {
+            g.neighbors[fill[v]++] = w;
+            g.neighbors[fill[w]++] = v;
+        }
+
+    // sort rows and remove edges that were present in both directions
+    thread_pool::global().parallel_for(n, 1024, [&](int begin, int end) {
+        for (auto v = begin; v < end; ++v)
+        {
+            auto const row_begin = g.neighbors.begin() + g.offsets[v];
+            auto const row_end = g.neighbors.begin() + g.offsets[v + 1];
+            std::sort(row_begin, row_end);
+            degree[v] = int(std::unique(row_begin, row_end) - row_begin);
+        }
+    });
+
+    auto write = 0;
+    for (auto v = 0; v < n; ++v)
+    {
+        auto const read = g.offsets[v];
+        for (auto i = 0; i < degree[v]; ++i)
+            g.neighbors[write + i] = g.neighbors[read + i];
+        g.offsets[v] = write;
+        write += degree[v];
+    }
+    g.offsets[n] = write;
+    g.neighbors.resize(write);
+
+    return g;
+}
+
+bool gp::neighbor_graph::save(std::string const& filename) const
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out)
+        return false;
+
+    std::int64_t const header[] = {size(), std::int64_t(neighbors.size()), has_distances() ? 1 : 0};
+    out.write(file_magic, sizeof(file_magic));
+    out.write(reinterpret_cast<char const*>(&file_version), sizeof(file_version));
+    out.write(reinterpret_cast<char const*>(header), sizeof(header));
+    write_array(out, offsets);
+    write_array(out, neighbors);
+    write_array(out, distances_sqr);
+
+    return bool(out);
+}
+
+bool gp::neighbor_graph::load(std::string const& filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+        return false;
+
+    char magic[4];
+    std::int32_t version;
+    std::int64_t header[3];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || std::memcmp(magic, file_magic, sizeof(magic)) != 0 || version != file_version || header[0] < 0 || header[1] < 0)
+        return false;
+
+    neighbor_graph g;
+    if (!read_array(in, g.offsets, header[0] + 1) || !read_array(in, g.neighbors, header[1]) || !read_array(in, g.distances_sqr, header[2] ? header[1] : 0))
+        return false;
+
+    // reject inconsistent files instead of reading out of bounds later
+    if (g.offsets.front() != 0 || g.offsets.back() != int(g.neighbors.size()))
+        return false;
+    for (auto i = 0; i < g.size(); ++i)
+        if (g.offsets[i] > g.offsets[i + 1])
+            return false;
+    for (auto idx : g.neighbors)
+        if (idx < 0 || idx >= g.size())
+            return false;
+
+    *this = std::move(g);
+    return true;
+}
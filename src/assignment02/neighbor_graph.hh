@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <polymesh/span.hh>
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+struct kd_tree;
+struct uniform_grid;
+
+/// directed neighborhood graph over the vertices of a point cloud in compressed sparse row layout
+/// the neighbors of the vertex with index i are neighbors[offsets[i]] .. neighbors[offsets[i + 1] - 1],
+/// sorted by distance (ties by index) unless noted otherwise
+struct neighbor_graph
+{
+    std::vector<int> offsets = {0};    ///< one entry per vertex index plus one
+    std::vector<int> neighbors;        ///< vertex indices
+    std::vector<float> distances_sqr; ///< empty or one entry per neighbor
+
+    /// k nearest neighbors of every vertex (the vertex itself excluded)
+    static neighbor_graph k_nearest(kd_tree const& tree, pm::vertex_attribute<tg::pos3> const& position, int k, bool store_distances = false);
+
+    /// all vertices within the given distance of every vertex (the vertex itself excluded)
+    /// the result is symmetric, vertices are processed in the Morton order of the grid
+    static neighbor_graph within_radius(uniform_grid const& grid, pm::vertex_attribute<tg::pos3> const& position, float radius, bool store_distances = false);
+
+    /// undirected version: w is a neighbor of v iff v was a neighbor of w or vice versa, rows sorted by index, no distances
+    neighbor_graph symmetrized() const;
+
+    /// number of vertex indices covered by the graph
+    int size() const { return int(offsets.size()) - 1; }
+    bool empty() const { return neighbors.empty(); }
+    bool has_distances() const { return !distances_sqr.empty(); }
+
+    pm::span<int const> neighbors_of(int idx) const { return {neighbors.data() + offsets[idx], neighbors.data() + offsets[idx + 1]}; }
+    pm::span<int const> neighbors_of(pm::vertex_handle v) const { return neighbors_of(v.idx.value); }
+
+    pm::span<float const> distances_sqr_of(int idx) const
+    {
+        return {distances_sqr.data() + offsets[idx], distances_sqr.data() + offsets[idx + 1]};
+    }
+
+    /// binary (de)serialization, returns false on failure
+    bool save(std::string const& filename) const;
+    bool load(std::string const& filename);
+};
+}
@@ -0,0 +1,373 @@
+#include "out_of_core.hh"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <typed-geometry/tg.hh>
+
+#include <common/thread_pool.hh>
+
+#include "kd_tree.hh"
+#include "neighbor_graph.hh"
+#include "task.hh"
+
+namespace
+{
+// file layout: magic, version, #points, points
+constexpr char file_magic[4] = {'G', 'P', 'P', 'C'};
+constexpr std::int32_t file_version = 1;
+constexpr std::streamoff header_size = sizeof(file_magic) + sizeof(file_version) + sizeof(std::int64_t);
+
+// more tiles make the per-tile bookkeeping more expensive than the tiles themselves
+constexpr int max_tiles = 1 << 20;
+
+// rough upper bound for the memory of one point in a tile:
+// gathered position and id, mesh vertex, position and normal attributes, kd-tree entry and nodes, neighbor row
+std::size_t bytes_per_point(int k) { return 96 + sizeof(int) * std::size_t(k); }
+
+bool write_header(std::ofstream& out, std::int64_t count)
+{
+    out.write(file_magic, sizeof(file_magic));
+    out.write(reinterpret_cast<char const*>(&file_version), sizeof(file_version));
+    out.write(reinterpret_cast<char const*>(&count), sizeof(count));
+    return bool(out);
+}
+
+// streams the points of a point file through a fixed-size buffer
+struct point_reader
+{
+    std::ifstream in;
+    std::int64_t count = 0;
+    std::vector<tg::pos3> buffer;
+
+    bool open(std::string const& filename)
+    {
+        in.open(filename, std::ios::binary);
+        if (!in)
+            return false;
+
+        char magic[4];
+        std::int32_t version;
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        return in && std::memcmp(magic, file_magic, sizeof(magic)) == 0 && version == file_version && count >= 0;
+    }
+
+    /// calls f(index, position) for every point in file order
+    template <class F>
+    bool for_each(F&& f)
+    {
+        in.clear();
+        in.seekg(header_size);
+        for (std::int64_t first = 0; first < count; first += std::int64_t(buffer.size()))
+        {
+            auto const n = std::min(std::int64_t(buffer.size()), count - first);
+            in.read(reinterpret_cast<char*>(buffer.data()), std::streamsize(n * sizeof(tg::pos3)));
+            if (!in)
+                return false;
+
+            for (auto i = 0; i < n; ++i)
+                f(first + i, buffer[i]);
+        }
+        return true;
+    }
+};
+
+// regular grid of tiles over the bounding box
+struct tiling
+{
+    tg::aabb3 bounds;
+    tg::ivec3 count = {1, 1, 1};
+    float halo = 0.0f;
+
+    int size() const { return count.x * count.y * count.z; }
+    int index(tg::ipos3 const& c) const { return (c.z * count.y + c.y) * count.x + c.x; }
+
+    float tile_size(int d) const { return (bounds.max[d] - bounds.min[d]) / float(count[d]); }
+
+    tg::ipos3 tile_of(tg::pos3 const& p) const
+    {
+        tg::ipos3 c;
+        for (auto d = 0; d < 3; ++d)
+        {
+            auto const s = tile_size(d);
+            c[d] = s > 0.0f ? int(tg::clamp((p[d] - bounds.min[d]) / s, 0.0f, float(count[d] - 1))) : 0;
+        }
+        return c;
+    }
+
+    /// calls f(tile index) for every tile whose box extended by the halo contains p
+    template <class F>
+    void for_each_tile_near(tg::pos3 const& p, F&& f) const
+    {
+        auto const lo = tile_of(p - tg::vec3(halo));
+        auto const hi = tile_of(p + tg::vec3(halo));
+        for (auto z = lo.z; z <= hi.z; ++z)
+            for (auto y = lo.y; y <= hi.y; ++y)
+                for (auto x = lo.x; x <= hi.x; ++x)
+                    f(index({x, y, z}));
+    }
+
+    /// distance from p to the border of the halo of tile c, borders on the bounding box do not count
+    float halo_margin(tg::pos3 const& p, tg::ipos3 const& c) const
+    {
+        auto margin = tg::max<float>();
+        for (auto d = 0; d < 3; ++d)
+        {
+            auto const s = tile_size(d);
+            if (c[d] > 0)
+                margin = tg::min(margin, p[d] - (bounds.min[d] + float(c[d]) * s - halo));
+            if (c[d] < count[d] - 1)
+                margin = tg::min(margin, bounds.min[d] + float(c[d] + 1) * s + halo - p[d]);
+        }
+        return margin;
+    }
+
+    /// halves the tiles along their longest side, false if that does not pay off anymore
+    bool split()
+    {
+        auto d = 0;
+        for (auto i = 1; i < 3; ++i)
+            if (tile_size(i) > tile_size(d))
+                d = i;
+
+        // once the tiles are much smaller than the halo, every halo box contains about the same points
+        if (2 * size() > max_tiles || tile_size(d) < 0.25f * halo)
+            return false;
+
+        count[d] *= 2;
+        return true;
+    }
+};
+
+// points of one tile, the points of the tile itself come before the halo
+struct tile_points
+{
+    std::vector<tg::pos3> core;
+    std::vector<std::int64_t> core_ids; ///< ascending point indices in the file
+    std::vector<tg::pos3> halo;
+};
+
+bool process_tile(tiling const& t, tile_points& points, int k, std::ofstream& out, gp::out_of_core_stats& stats)
+{
+    auto const num_core = int(points.core.size());
+    auto const num_points = num_core + int(points.halo.size());
+
+    pm::Mesh mesh;
+    mesh.vertices().reserve(num_points);
+    pm::vertex_attribute<tg::pos3> position(mesh);
+    for (auto const& p : points.core)
+        position[mesh.vertices().add()] = p;
+    for (auto const& p : points.halo)
+        position[mesh.vertices().add()] = p;
+    points.core = {};
+    points.halo = {};
+
+    // same neighborhoods as neighbor_graph::k_nearest, but only for the points of the tile itself
+    gp::kd_tree const tree(position);
+    auto const row_size = tg::max(0, tg::min(k, num_points - 1));
+
+    gp::neighbor_graph graph;
+    graph.offsets.resize(num_points + 1);
+    for (auto i = 0; i < num_points; ++i)
+        graph.offsets[i + 1] = graph.offsets[i] + (i < num_core ? row_size : 0);
+    graph.neighbors.resize(graph.offsets[num_points]);
+
+    std::atomic<std::int64_t> uncertain = 0;
+    gp::thread_pool::global().parallel_for(num_core, 1024, [&](int begin, int end) {
+        std::vector<gp::kd_tree::neighbor> result;
+        auto uncertain_chunk = 0;
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const p = position[pm::vertex_index(i)];
+            tree.k_nearest(p, k, result, i);
+            for (auto j = 0; j < row_size; ++j)
+                graph.neighbors[graph.offsets[i] + j] = result[j].idx;
+
+            // a closer point outside of the halo could have been missed
+            auto const margin = t.halo_margin(p, t.tile_of(p));
+            if (row_size < k || result.back().dist_sqr > margin * margin)
+                ++uncertain_chunk;
+        }
+        uncertain += uncertain_chunk;
+    });
+    stats.uncertain_points += uncertain;
+
+    pm::vertex_attribute<tg::dir3> normal(mesh);
+    gp::thread_pool::global().parallel_for(num_core, 1024, [&](int begin, int end) { task::compute_normals(graph, begin, end, position, normal); });
+
+    // write back consecutive runs of points
+    auto const& ids = points.core_ids;
+    for (auto begin = 0; begin < num_core;)
+    {
+        auto end = begin + 1;
+        while (end < num_core && ids[end] == ids[end - 1] + 1)
+            ++end;
+
+        out.seekp(header_size + std::streamoff(ids[begin] * std::int64_t(sizeof(tg::dir3))));
+        out.write(reinterpret_cast<char const*>(normal.data() + begin), std::streamsize((end - begin) * sizeof(tg::dir3)));
+        begin = end;
+    }
+
+    stats.max_tile_points = tg::max(stats.max_tile_points, std::int64_t(num_points));
+    return bool(out);
+}
+}
+
+bool gp::write_point_file(std::string const& filename, pm::vertex_attribute<tg::pos3> const& position)
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out || !write_header(out, position.mesh().vertices().size()))
+        return false;
+
+    for (auto const v : position.mesh().vertices())
+        out.write(reinterpret_cast<char const*>(&position[v]), sizeof(tg::pos3));
+
+    return bool(out);
+}
+
+bool gp::estimate_normals_out_of_core(std::string const& point_filename,
+                                      std::string const& normal_filename,
+                                      out_of_core_settings const& settings,
+                                      out_of_core_stats& stats)
+{
+    stats = {};
+
+    point_reader reader;
+    if (!reader.open(point_filename))
+        return false;
+    auto const n = reader.count;
+    stats.num_points = n;
+
+    // the read buffer gets a 16th of the budget, the tiles the rest
+    auto const k = tg::max(1, settings.k);
+    auto const buffer_size = tg::clamp(settings.memory_budget / 16 / sizeof(tg::pos3), std::size_t(1024), std::size_t(1) << 20);
+    auto const buffer_bytes = buffer_size * sizeof(tg::pos3);
+    if (settings.memory_budget <= buffer_bytes + bytes_per_point(k) * std::size_t(k + 1))
+        return false;
+    auto const capacity = std::int64_t((settings.memory_budget - buffer_bytes) / bytes_per_point(k));
+    reader.buffer.resize(buffer_size);
+
+    std::ofstream out(normal_filename, std::ios::binary);
+    if (!out || !write_header(out, n))
+        return false;
+    if (n == 0)
+        return true;
+
+    // first pass: bounding box
+    tiling t;
+    auto const bounded = reader.for_each([&](std::int64_t id, tg::pos3 const& p) {
+        t.bounds = id == 0 ? tg::aabb3(p, p) : tg::aabb_of(t.bounds, p);
+    });
+    if (!bounded)
+        return false;
+    ++stats.num_passes;
+
+    if (settings.halo > 0.0f)
+        t.halo = settings.halo;
+    else
+    {
+        // sample spacing of a surface spanned by the two largest extents (see uniform_grid),
+        // k neighbors cover a disk of radius spacing * sqrt(k / pi), take a generous multiple of that
+        auto const extent = t.bounds.max - t.bounds.min;
+        auto e = std::array<float, 3>{extent.x, extent.y, extent.z};
+        std::sort(e.begin(), e.end());
+        auto const spacing = tg::sqrt(e[2] * tg::max(e[1], e[2] * 1e-3f) / float(n));
+        t.halo = 3.0f * spacing * tg::sqrt(float(k) / tg::pi_scalar<float>);
+    }
+    stats.halo = t.halo;
+
+    // initial guess assuming evenly distributed points
+    while (std::int64_t(t.size()) * capacity < n && t.split())
+        ;
+
+    // refine until every tile fits into the budget including its halo
+    std::vector<std::int64_t> core_count;
+    std::vector<std::int64_t> halo_count;
+    while (true)
+    {
+        core_count.assign(t.size(), 0);
+        halo_count.assign(t.size(), 0);
+        auto const counted = reader.for_each([&](std::int64_t, tg::pos3 const& p) {
+            ++core_count[t.index(t.tile_of(p))];
+            t.for_each_tile_near(p, [&](int i) { ++halo_count[i]; });
+        });
+        if (!counted)
+            return false;
+        ++stats.num_passes;
+
+        if (*std::max_element(halo_count.begin(), halo_count.end()) <= capacity)
+            break;
+        if (!t.split())
+            return false;
+    }
+
+    std::vector<int> tiles;
+    for (auto i = 0; i < t.size(); ++i)
+        if (core_count[i] > 0)
+            tiles.push_back(i);
+    stats.num_tiles = int(tiles.size());
+
+    // gather as many tiles per pass as fit into the budget
+    std::vector<int> slot_of(t.size(), -1);
+    for (auto first = 0; first < int(tiles.size());)
+    {
+        auto last = first;
+        auto batch_points = std::int64_t(0);
+        while (last < int(tiles.size()) && batch_points + halo_count[tiles[last]] <= capacity)
+        {
+            batch_points += halo_count[tiles[last]];
+            slot_of[tiles[last]] = last - first;
+            ++last;
+        }
+
+        std::vector<tile_points> batch(last - first);
+        for (auto s = 0; s < int(batch.size()); ++s)
+        {
+            auto const i = tiles[first + s];
+            batch[s].core.reserve(core_count[i]);
+            batch[s].core_ids.reserve(core_count[i]);
+            batch[s].halo.reserve(halo_count[i] - core_count[i]);
+        }
+
+        auto const gathered = reader.for_each([&](std::int64_t id, tg::pos3 const& p) {
+            auto const home = t.index(t.tile_of(p));
+            t.for_each_tile_near(p, [&](int i) {
+                auto const s = slot_of[i];
+                if (s < 0)
+                    return;
+
+                if (i == home)
+                {
+                    batch[s].core.push_back(p);
+                    batch[s].core_ids.push_back(id);
+                }
+                else
+                    batch[s].halo.push_back(p);
+            });
+        });
+        if (!gathered)
+            return false;
+        ++stats.num_passes;
+
+        for (auto s = 0; s < int(batch.size()); ++s)
+        {
+            if (!process_tile(t, batch[s], k, out, stats))
+                return false;
+            batch[s] = {};
+            slot_of[tiles[first + s]] = -1;
+
+            if (settings.progress)
+                settings.progress(first + s + 1, int(tiles.size()));
+        }
+
+        first = last;
+    }
+
+    return bool(out);
+}
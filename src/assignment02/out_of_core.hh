@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <polymesh/Mesh.hh>
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+/// binary point file: magic "GPPC", int32 version, int64 number of points, then x y z as float per point
+/// the normals written by estimate_normals_out_of_core use the same layout, one normal per input point
+bool write_point_file(std::string const& filename, pm::vertex_attribute<tg::pos3> const& position);
+
+struct out_of_core_settings
+{
+    /// the k in k-nearest-neighbors
+    int k = 10;
+
+    /// upper bound for the memory used by the point data (in bytes)
+    std::size_t memory_budget = std::size_t(1) << 30;
+
+    /// margin around every tile from which neighbors are taken, <= 0 derives it from the point density
+    float halo = 0.0f;
+
+    /// called with the number of processed tiles and the total number of tiles
+    std::function<void(int, int)> progress;
+};
+
+struct out_of_core_stats
+{
+    std::int64_t num_points = 0;
+    int num_tiles = 0;  ///< non-empty tiles
+    int num_passes = 0; ///< passes over the input file
+    std::int64_t max_tile_points = 0;
+    float halo = 0.0f;
+
+    /// points whose k nearest neighbors could reach beyond the halo of their tile
+    /// their normals may differ from the ones computed in memory, increase the halo if this is not 0
+    std::int64_t uncertain_points = 0;
+};
+
+/// estimates an (unoriented) normal for every point of a point file that may be larger than the available memory
+/// the bounding box is cut into tiles that are processed independently, each one together with its halo;
+/// as many tiles as fit into the memory budget are gathered in a single pass over the input
+/// returns false if a file cannot be read or written, or if no tiling fits into the budget
+bool estimate_normals_out_of_core(std::string const& point_filename,
+                                  std::string const& normal_filename,
+                                  out_of_core_settings const& settings,
+                                  out_of_core_stats& stats);
+}
@@ -0,0 +1,104 @@
+#include "space_filling_curve.hh"
+
+#include <algorithm>
+#include <utility>
+
+#include <typed-geometry/tg.hh>
+
+namespace
+{
+// inserts two zero bits after each of the lower 21 bits
+std::uint64_t spread_bits(std::uint64_t x)
+{
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffff;
+    x = (x | x << 16) & 0x1f0000ff0000ff;
+    x = (x | x << 8) & 0x100f00f00f00f00f;
+    x = (x | x << 4) & 0x10c30c30c30c30c3;
+    x = (x | x << 2) & 0x1249249249249249;
+    return x;
+}
+}
+
+std::uint64_t gp::morton_code(tg::ipos3 const& cell)
+{
+    return spread_bits(std::uint64_t(cell.x)) | spread_bits(std::uint64_t(cell.y)) << 1 | spread_bits(std::uint64_t(cell.z)) << 2;
+}
+
+std::uint64_t gp::hilbert_code(tg::ipos3 const& cell)
+{
+    // J. Skilling, "Programming the Hilbert curve": converts the coordinates into the transposed Hilbert index,
+    // whose bits interleaved (x most significant) give the index along the curve
+    std::uint32_t x[3] = {std::uint32_t(cell.x), std::uint32_t(cell.y), std::uint32_t(cell.z)};
+    auto const top = std::uint32_t(1) << (curve_bits - 1);
+
+    // inverse undo
+    for (auto q = top; q > 1; q >>= 1)
+    {
+        auto const p = q - 1;
+        for (auto i = 0; i < 3; ++i)
+        {
+            if (x[i] & q)
+                x[0] ^= p; // invert
+            else
+            {
+                auto const t = (x[0] ^ x[i]) & p; // exchange
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+
+    // Gray encode
+    x[1] ^= x[0];
+    x[2] ^= x[1];
+    auto t = std::uint32_t(0);
+    for (auto q = top; q > 1; q >>= 1)
+        if (x[2] & q)
+            t ^= q - 1;
+    for (auto& c : x)
+        c ^= t;
+
+    return spread_bits(x[0]) << 2 | spread_bits(x[1]) << 1 | spread_bits(x[2]);
+}
+
+std::vector<int> gp::space_filling_curve_layout(pm::vertex_attribute<tg::pos3> const& position, curve_type curve)
+{
+    auto const& mesh = position.mesh();
+    auto const n = mesh.all_vertices().size();
+
+    std::vector<std::pair<std::uint64_t, int>> keys;
+    keys.reserve(mesh.vertices().size());
+    if (!mesh.vertices().empty())
+    {
+        // uniform scale, so that the curve is not distorted for flat bounding boxes
+        auto const bb = tg::aabb_of(position);
+        auto const extent = bb.max - bb.min;
+        auto const max_extent = tg::max(extent.x, tg::max(extent.y, extent.z));
+        auto const max_cell = float((1 << curve_bits) - 1);
+        auto const scale = max_extent > 0.0f ? max_cell / max_extent : 0.0f;
+
+        for (auto const v : mesh.vertices())
+        {
+            auto const d = (position[v] - bb.min) * scale;
+            auto const cell = tg::ipos3(int(tg::clamp(d.x, 0.0f, max_cell)), int(tg::clamp(d.y, 0.0f, max_cell)), int(tg::clamp(d.z, 0.0f, max_cell)));
+            keys.push_back({curve == curve_type::hilbert ? hilbert_code(cell) : morton_code(cell), int(v.idx)});
+        }
+        std::sort(keys.begin(), keys.end());
+    }
+
+    std::vector<int> p(n, -1);
+    auto next = 0;
+    for (auto const& k : keys)
+        p[k.second] = next++;
+    for (auto& i : p)
+        if (i < 0)
+            i = next++;
+
+    return p;
+}
+
+void gp::sort_along_curve(pm::Mesh& m, pm::vertex_attribute<tg::pos3> const& position, curve_type curve)
+{
+    m.vertices().permute(space_filling_curve_layout(position, curve));
+}
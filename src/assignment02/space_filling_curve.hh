@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+enum class curve_type
+{
+    morton,
+    hilbert
+};
+
+/// coordinates of up to 21 bits per dimension fit into the 64 bit curve indices
+constexpr int curve_bits = 21;
+
+/// position of a grid cell along the Morton (Z-order) curve
+std::uint64_t morton_code(tg::ipos3 const& cell);
+
+/// position of a grid cell along the Hilbert curve (consecutive indices are face-adjacent cells)
+std::uint64_t hilbert_code(tg::ipos3 const& cell);
+
+/// Calculates a vertex layout following a space-filling curve through the bounding box of the positions
+/// Can be applied using m.vertices().permute(...)
+/// Returns remapping [curr_idx] = new_idx, removed vertices are moved to the end
+std::vector<int> space_filling_curve_layout(pm::vertex_attribute<tg::pos3> const& position, curve_type curve);
+
+/// permutes the vertices of the mesh (and all of its vertex attributes) into the order of the curve
+/// NOTE: invalidates all vertex handles
+void sort_along_curve(pm::Mesh& m, pm::vertex_attribute<tg::pos3> const& position, curve_type curve);
+}
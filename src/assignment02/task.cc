@@ -3,6 +3,8 @@
 #include <typed-geometry/tg.hh>
 #include <iostream>
 
+#include "covariance.hh"
+
 tg::dir3 task::compute_normal(std::vector<pm::vertex_handle> const& vs, pm::vertex_attribute<tg::pos3> const& position)
 {
     // the normal to be computed
@@ -26,42 +28,12 @@ tg::dir3 task::compute_normal(std::vector<pm::vertex_handle> const& vs, pm::vert
      *
      */
     // ----- %< -------------------------------------------------------
-    std::vector<tg::pos3> current_points;
-    for (auto v : vs) {
-        current_points.push_back(position[v]);
-    }
-    float X = 0.0, Y = 0.0, Z = 0.0;
-    for (auto p : current_points) {
-        X += p.x;
-        Y += p.y;
-        Z += p.z;
-    }
-    X /= current_points.size();
-    Y /= current_points.size();
-    Z /= current_points.size();
-    tg::mat3 M;
-    for (auto p : current_points) {
-        tg::pos3 centered_point = { p.x - X, p.y - Y, p.z - Z };
-        float x_squared = centered_point.x * centered_point.x;
-        float y_squared = centered_point.y * centered_point.y;
-        float z_squared = centered_point.z * centered_point.z;
-        float x_pdt_y = centered_point.x * centered_point.y;
-        float x_pdt_z = centered_point.x * centered_point.z;
-        float y_pdt_z = centered_point.y * centered_point.z;
-        M[0][0] += x_squared;
-        M[0][1] += x_pdt_y;
-        M[0][2] += x_pdt_z;
-        M[1][0] += x_pdt_y;
-        M[1][1] += y_squared;
-        M[1][2] += y_pdt_z;
-        M[2][0] += x_pdt_z;
-        M[2][1] += y_pdt_z;
-        M[2][2] += z_squared;
-    }
+    // single streaming pass over the neighborhood, no temporary copies
+    gp::covariance_accumulator acc;
+    for (auto v : vs)
+        acc.add(position[v]);
 
-    auto eigen = tg::eigen_decomposition_symmetric(M);
-    auto sm_eigenvector = eigen[0].eigenvector;
-    normal = { sm_eigenvector.x, sm_eigenvector.y, sm_eigenvector.z };
+    normal = gp::smallest_eigenvector(acc.scatter());
 
     // ----- %< -------------------------------------------------------
     /*
@@ -109,3 +81,111 @@ float task::compute_mst_weight(pm::vertex_handle v0, pm::vertex_handle v1, pm::v
 
     return weight;
 }
+
+void task::compute_normals(gp::neighbor_graph const& graph, int begin, int end, pm::vertex_attribute<tg::pos3> const& position, pm::vertex_attribute<tg::dir3>& normal)
+{
+    // neighborhoods are processed in groups of 'lanes', all sums are kept as structure of arrays
+    // so that the accumulation loops vectorize. Every lane performs exactly the operations of compute_normal.
+    constexpr int lanes = 8;
+
+    auto const& offsets = graph.offsets;
+    auto const& vs = graph.neighbors;
+
+    for (auto first = begin; first < end; first += lanes)
+    {
+        auto const active = tg::min(lanes, end - first);
+
+        int size[lanes] = {};
+        float rx[lanes] = {}, ry[lanes] = {}, rz[lanes] = {};
+        float sx[lanes] = {}, sy[lanes] = {}, sz[lanes] = {};
+        float sxx[lanes] = {}, sxy[lanes] = {}, sxz[lanes] = {}, syy[lanes] = {}, syz[lanes] = {}, szz[lanes] = {};
+
+        auto max_size = 0;
+        for (auto l = 0; l < active; ++l)
+        {
+            size[l] = offsets[first + l + 1] - offsets[first + l];
+            max_size = tg::max(max_size, size[l]);
+            if (size[l] > 0)
+            {
+                auto const r = position[pm::vertex_index(vs[offsets[first + l]])];
+                rx[l] = r.x;
+                ry[l] = r.y;
+                rz[l] = r.z;
+            }
+        }
+
+        for (auto j = 0; j < max_size; ++j)
+        {
+            // gather, lanes without a j-th point contribute a zero offset
+            float dx[lanes], dy[lanes], dz[lanes];
+            for (auto l = 0; l < lanes; ++l)
+            {
+                auto const p = j < size[l] ? position[pm::vertex_index(vs[offsets[first + l] + j])] : tg::pos3(rx[l], ry[l], rz[l]);
+                dx[l] = p.x;
+                dy[l] = p.y;
+                dz[l] = p.z;
+            }
+
+            for (auto l = 0; l < lanes; ++l)
+            {
+                dx[l] -= rx[l];
+                dy[l] -= ry[l];
+                dz[l] -= rz[l];
+                sx[l] += dx[l];
+                sy[l] += dy[l];
+                sz[l] += dz[l];
+                sxx[l] += dx[l] * dx[l];
+                sxy[l] += dx[l] * dy[l];
+                sxz[l] += dx[l] * dz[l];
+                syy[l] += dy[l] * dy[l];
+                syz[l] += dy[l] * dz[l];
+                szz[l] += dz[l] * dz[l];
+            }
+        }
+
+        for (auto l = 0; l < active; ++l)
+        {
+            gp::covariance_accumulator acc;
+            acc.reference = {rx[l], ry[l], rz[l]};
+            acc.sum = {sx[l], sy[l], sz[l]};
+            acc.sum_sqr = {sxx[l], sxy[l], sxz[l], syy[l], syz[l], szz[l]};
+            acc.count = size[l];
+            normal[pm::vertex_index(first + l)] = gp::smallest_eigenvector(acc.scatter());
+        }
+    }
+}
+
+void task::compute_normals_adaptive(gp::neighbor_graph const& graph,
+                                    int begin,
+                                    int end,
+                                    int min_k,
+                                    pm::vertex_attribute<tg::pos3> const& position,
+                                    pm::vertex_attribute<tg::dir3>& normal)
+{
+    for (auto i = begin; i < end; ++i)
+    {
+        auto const vs = graph.neighbors_of(i);
+        auto const size = int(vs.size());
+
+        gp::covariance_accumulator acc;
+        gp::symmetric_mat3 best;
+        auto best_variation = tg::max<float>();
+        for (auto j = 0; j < size; ++j)
+        {
+            acc.add(position[pm::vertex_index(vs[j])]);
+            if (j + 1 < min_k && j + 1 < size)
+                continue;
+
+            // the eigenvalues are closed-form, so testing every scale is cheap compared to the neighbor lookups
+            auto const scatter = acc.scatter();
+            auto const variation = gp::surface_variation(scatter);
+            if (variation < best_variation)
+            {
+                best = scatter;
+                best_variation = variation;
+            }
+        }
+
+        normal[pm::vertex_index(i)] = gp::smallest_eigenvector(best);
+    }
+}
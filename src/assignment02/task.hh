@@ -1,9 +1,25 @@
 #include <polymesh/Mesh.hh>
 #include <typed-geometry/tg-lean.hh>
 
+#include "neighbor_graph.hh"
+
 namespace task
 {
 tg::dir3 compute_normal(std::vector<pm::vertex_handle> const& vs, pm::vertex_attribute<tg::pos3> const& position);
 
+/// batched version of compute_normal for the vertices with indices in [begin, end) and their neighborhoods in graph
+/// gives exactly the same normals as calling compute_normal for every neighborhood
+void compute_normals(gp::neighbor_graph const& graph, int begin, int end, pm::vertex_attribute<tg::pos3> const& position, pm::vertex_attribute<tg::dir3>& normal);
+
+/// adaptive version of compute_normals: every neighborhood is grown one neighbor at a time (nearest first),
+/// the normal is taken at the size in [min_k, row size] with the lowest surface variation
+/// the covariance sums are updated incrementally, so this costs about as much as one pass over the full rows
+void compute_normals_adaptive(gp::neighbor_graph const& graph,
+                              int begin,
+                              int end,
+                              int min_k,
+                              pm::vertex_attribute<tg::pos3> const& position,
+                              pm::vertex_attribute<tg::dir3>& normal);
+
 float compute_mst_weight(pm::vertex_handle v0, pm::vertex_handle v1, pm::vertex_attribute<tg::pos3> const& position, pm::vertex_attribute<tg::dir3> const& normal);
 }
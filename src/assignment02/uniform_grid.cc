@@ -0,0 +1,137 @@
+#include "uniform_grid.hh"
+
+#include <algorithm>
+#include <array>
+
+#include <typed-geometry/tg.hh>
+
+#include "space_filling_curve.hh"
+
+namespace
+{
+constexpr int max_cells_per_dim = 1 << gp::curve_bits;
+
+int hash_slot(std::uint64_t key, int table_size) { return int((key * 0x9E3779B97F4A7C15ull) >> 32) & (table_size - 1); }
+}
+
+gp::uniform_grid::uniform_grid(pm::vertex_attribute<tg::pos3> const& position, float cell_size)
+{
+    auto const& mesh = position.mesh();
+    auto const n = mesh.vertices().size();
+    if (n == 0)
+        return;
+
+    auto const bb = tg::aabb_of(position);
+    auto const extent = bb.max - bb.min;
+    _origin = bb.min;
+
+    if (cell_size <= 0.0f)
+        cell_size = default_cell_size(position);
+
+    // keep the cell coordinates representable in the Morton code
+    auto const max_extent = tg::max(extent.x, tg::max(extent.y, extent.z));
+    _cell_size = tg::max(cell_size, max_extent / float(max_cells_per_dim - 1));
+    if (_cell_size <= 0.0f)
+        _cell_size = 1.0f; // all points coincide
+    _max_cell = tg::min(int(max_extent / _cell_size), max_cells_per_dim - 1);
+
+    // sort points by (cell, index)
+    std::vector<std::pair<std::uint64_t, int>> keys;
+    keys.reserve(n);
+    for (auto const v : mesh.vertices())
+        keys.push_back({morton_code(cell_of(position[v])), int(v.idx)});
+    std::sort(keys.begin(), keys.end());
+
+    _entries.resize(n);
+    _order.resize(n);
+    for (auto i = 0; i < n; ++i)
+    {
+        _order[i] = keys[i].second;
+        _entries[i] = {position[pm::vertex_index(keys[i].second)], keys[i].second};
+
+        if (i == 0 || keys[i].first != keys[i - 1].first)
+        {
+            _cell_keys.push_back(keys[i].first);
+            _cell_offsets.push_back(i);
+        }
+    }
+    _cell_offsets.push_back(n);
+
+    // hash table with load factor <= 0.5
+    auto table_size = 1;
+    while (table_size < 2 * int(_cell_keys.size()))
+        table_size *= 2;
+    _table.assign(table_size, -1);
+    for (auto c = 0; c < int(_cell_keys.size()); ++c)
+    {
+        auto slot = hash_slot(_cell_keys[c], table_size);
+        while (_table[slot] >= 0)
+            slot = (slot + 1) & (table_size - 1);
+        _table[slot] = c;
+    }
+}
+
+float gp::uniform_grid::default_cell_size(pm::vertex_attribute<tg::pos3> const& position)
+{
+    auto const n = position.mesh().vertices().size();
+    if (n == 0)
+        return 1.0f;
+
+    // sample spacing of a surface spanned by the two largest extents
+    auto const bb = tg::aabb_of(position);
+    auto const extent = bb.max - bb.min;
+    auto e = std::array<float, 3>{extent.x, extent.y, extent.z};
+    std::sort(e.begin(), e.end());
+    auto const area = e[2] * tg::max(e[1], e[2] * 1e-3f);
+    return tg::sqrt(area * 8.0f / float(n));
+}
+
+tg::ipos3 gp::uniform_grid::cell_of(tg::pos3 const& p) const
+{
+    auto const d = (p - _origin) / _cell_size;
+    auto const m = float(_max_cell);
+    return {int(tg::clamp(d.x, 0.0f, m)), int(tg::clamp(d.y, 0.0f, m)), int(tg::clamp(d.z, 0.0f, m))};
+}
+
+int gp::uniform_grid::find_cell(std::uint64_t key) const
+{
+    auto const table_size = int(_table.size());
+    auto slot = hash_slot(key, table_size);
+    while (_table[slot] >= 0)
+    {
+        if (_cell_keys[_table[slot]] == key)
+            return _table[slot];
+        slot = (slot + 1) & (table_size - 1);
+    }
+    return -1;
+}
+
+void gp::uniform_grid::within_radius(tg::pos3 const& p, float radius, std::vector<kd_tree::neighbor>& result, int exclude) const
+{
+    result.clear();
+    if (_entries.empty() || radius < 0)
+        return;
+
+    auto const radius_sqr = radius * radius;
+    auto const lo = cell_of(p - tg::vec3(radius));
+    auto const hi = cell_of(p + tg::vec3(radius));
+
+    for (auto z = lo.z; z <= hi.z; ++z)
+        for (auto y = lo.y; y <= hi.y; ++y)
+            for (auto x = lo.x; x <= hi.x; ++x)
+            {
+                auto const c = find_cell(morton_code({x, y, z}));
+                if (c < 0)
+                    continue;
+
+                for (auto i = _cell_offsets[c]; i < _cell_offsets[c + 1]; ++i)
+                {
+                    auto const& e = _entries[i];
+                    auto const dist_sqr = tg::distance_sqr(p, e.pos);
+                    if (dist_sqr <= radius_sqr && e.idx != exclude)
+                        result.push_back({dist_sqr, e.idx});
+                }
+            }
+
+    std::sort(result.begin(), result.end());
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <typed-geometry/tg-lean.hh>
+
+#include "kd_tree.hh"
+
+namespace gp
+{
+/// hashed uniform grid over the vertex positions of a (point cloud) mesh for fixed-radius neighborhood queries
+/// points are stored sorted by the Morton code of their cell, so neighboring cells are close in memory
+/// NOTE: the grid stores a copy of the positions, rebuild it when the positions change
+struct uniform_grid
+{
+    /// cell_size <= 0 picks default_cell_size(position)
+    explicit uniform_grid(pm::vertex_attribute<tg::pos3> const& position, float cell_size = 0.0f);
+
+    /// a size from the bounding box and the number of points, assuming a scanned surface that is roughly uniformly
+    /// sampled (about 8 points per occupied cell)
+    static float default_cell_size(pm::vertex_attribute<tg::pos3> const& position);
+
+    /// writes all vertices with distance <= radius to p into result, sorted by increasing distance (ties by index)
+    /// exclude is a vertex index, -1 for none
+    /// visits all cells overlapping the cube around p, at most 27 cells if the cell size is at least the radius
+    void within_radius(tg::pos3 const& p, float radius, std::vector<kd_tree::neighbor>& result, int exclude = -1) const;
+
+    /// vertex indices in the Morton order of their cells, iterating in this order keeps queries cache-friendly
+    std::vector<int> const& morton_order() const { return _order; }
+
+    float cell_size() const { return _cell_size; }
+    int size() const { return int(_order.size()); }
+
+private:
+    struct entry
+    {
+        tg::pos3 pos;
+        int idx; ///< vertex index
+    };
+
+    tg::ipos3 cell_of(tg::pos3 const& p) const;
+    int find_cell(std::uint64_t key) const; ///< -1 if the cell is empty
+
+    tg::pos3 _origin;
+    float _cell_size = 1.0f;
+    int _max_cell = 0; ///< cell coordinates are in [0, _max_cell]
+
+    std::vector<entry> _entries;           ///< points sorted by cell
+    std::vector<int> _order;               ///< vertex index of every entry
+    std::vector<std::uint64_t> _cell_keys; ///< sorted Morton codes of the occupied cells
+    std::vector<int> _cell_offsets;        ///< entries of cell c are _entries[_cell_offsets[c]] .. _entries[_cell_offsets[c + 1] - 1]
+    std::vector<int> _table;               ///< open addressing hash table of cell indices, -1 for empty slots
+};
+}
@@ -0,0 +1,138 @@
+#include "implicit_smoothing.hh"
+
+#include <vector>
+
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseCore>
+
+#include <typed-geometry/tg.hh>
+
+using sparse_matrix = Eigen::SparseMatrix<double>;
+
+struct gp::implicit_smoother::factorization
+{
+    std::vector<int> unknowns;    ///< vertex index of every unknown
+    Eigen::VectorXd mass;         ///< D of every unknown
+    sparse_matrix coupling;       ///< columns of the system matrix belonging to fixed vertices (by vertex index)
+    Eigen::SimplicialLDLT<sparse_matrix> solver;
+    int num_vertices = 0;
+};
+
+gp::implicit_smoother::implicit_smoother() = default;
+gp::implicit_smoother::~implicit_smoother() = default;
+gp::implicit_smoother::implicit_smoother(implicit_smoother&&) noexcept = default;
+gp::implicit_smoother& gp::implicit_smoother::operator=(implicit_smoother&&) noexcept = default;
+
+gp::implicit_smoother::implicit_smoother(pm::Mesh const& mesh,
+                                         pm::edge_attribute<float> const& edge_weight,
+                                         pm::vertex_attribute<bool> const& locked,
+                                         bool bilaplacian,
+                                         float time_step)
+  : _factorization(std::make_unique<factorization>()), _time_step(time_step)
+{
+    auto& fac = *_factorization;
+    auto const n = mesh.all_vertices().size();
+    fac.num_vertices = n;
+
+    // K = W - D over all vertex indices
+    Eigen::VectorXd weight_sum = Eigen::VectorXd::Zero(n);
+    std::vector<Eigen::Triplet<double>> triplets;
+    for (auto const e : mesh.edges())
+    {
+        auto const i = e.vertexA().idx.value;
+        auto const j = e.vertexB().idx.value;
+        auto const w = double(edge_weight[e]);
+        triplets.emplace_back(i, j, w);
+        triplets.emplace_back(j, i, w);
+        weight_sum[i] += w;
+        weight_sum[j] += w;
+    }
+    for (auto i = 0; i < n; ++i)
+        triplets.emplace_back(i, i, -weight_sum[i]);
+
+    sparse_matrix K(n, n);
+    K.setFromTriplets(triplets.begin(), triplets.end());
+
+    sparse_matrix A;
+    if (bilaplacian)
+    {
+        // the Laplacian of locked vertices (and of vertices without weights) is zero, as in the iterative methods
+        Eigen::VectorXd inv_weight_sum = Eigen::VectorXd::Zero(n);
+        for (auto const v : mesh.vertices())
+            if (!locked[v] && weight_sum[v.idx.value] != 0)
+                inv_weight_sum[v.idx.value] = 1 / weight_sum[v.idx.value];
+        A = sparse_matrix(K * inv_weight_sum.asDiagonal()) * K * double(time_step);
+    }
+    else
+        A = K * -double(time_step);
+    A += sparse_matrix(weight_sum.asDiagonal());
+
+    // unknowns: free vertices with neighbors, all others keep their position
+    std::vector<int> unknown_of(n, -1);
+    for (auto const v : mesh.vertices())
+        if (!locked[v] && weight_sum[v.idx.value] != 0)
+        {
+            unknown_of[v.idx.value] = int(fac.unknowns.size());
+            fac.unknowns.push_back(v.idx.value);
+        }
+    auto const m = int(fac.unknowns.size());
+
+    fac.mass.resize(m);
+    for (auto r = 0; r < m; ++r)
+        fac.mass[r] = weight_sum[fac.unknowns[r]];
+
+    std::vector<Eigen::Triplet<double>> free_triplets;
+    std::vector<Eigen::Triplet<double>> coupling_triplets;
+    for (auto c = 0; c < A.outerSize(); ++c)
+        for (sparse_matrix::InnerIterator it(A, c); it; ++it)
+        {
+            auto const r = unknown_of[it.row()];
+            if (r < 0)
+                continue;
+            if (unknown_of[c] >= 0)
+                free_triplets.emplace_back(r, unknown_of[c], it.value());
+            else
+                coupling_triplets.emplace_back(r, c, it.value());
+        }
+
+    sparse_matrix A_free(m, m);
+    A_free.setFromTriplets(free_triplets.begin(), free_triplets.end());
+    fac.coupling.resize(m, n);
+    fac.coupling.setFromTriplets(coupling_triplets.begin(), coupling_triplets.end());
+
+    fac.solver.compute(A_free);
+}
+
+bool gp::implicit_smoother::is_valid() const { return _factorization && _factorization->solver.info() == Eigen::Success; }
+
+void gp::implicit_smoother::smooth(pm::vertex_attribute<tg::pos3>& position, int steps) const
+{
+    if (!is_valid())
+        return;
+
+    auto const& fac = *_factorization;
+    auto const m = int(fac.unknowns.size());
+
+    Eigen::MatrixX3d x(fac.num_vertices, 3);
+    for (auto i = 0; i < fac.num_vertices; ++i)
+        for (auto c = 0; c < 3; ++c)
+            x(i, c) = position.data()[i][c];
+
+    // the fixed vertices do not change, neither does their contribution to the right hand side
+    Eigen::MatrixX3d const fixed = fac.coupling * x;
+
+    Eigen::MatrixX3d b(m, 3);
+    for (auto s = 0; s < steps; ++s)
+    {
+        for (auto r = 0; r < m; ++r)
+            b.row(r) = fac.mass[r] * x.row(fac.unknowns[r]);
+        b -= fixed;
+
+        Eigen::MatrixX3d const x_free = fac.solver.solve(b);
+        for (auto r = 0; r < m; ++r)
+            x.row(fac.unknowns[r]) = x_free.row(r);
+    }
+
+    for (auto r = 0; r < m; ++r)
+        position.data()[fac.unknowns[r]] = tg::pos3(float(x(fac.unknowns[r], 0)), float(x(fac.unknowns[r], 1)), float(x(fac.unknowns[r], 2)));
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+
+#include <polymesh/Mesh.hh>
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+/// implicit (backward Euler) Laplacian or bi-Laplacian smoothing: every step solves (I - t L) x' = x
+/// (or (I + t L^2) x' = x) for all three coordinates, locked vertices are fixed boundary conditions
+/// with K = W - D (edge weights W, weight sums D) the normalized Laplacian is L = D^-1 K, multiplied by D the systems
+///   Laplacian:    (D - t K) x' = D x
+///   bi-Laplacian: (D + t K D^-1 K) x' = D x
+/// where the inverse weight sums of locked vertices are zero, so their Laplacian is zero as in smooth_jacobi and
+/// smooth_gauss_seidel, and all methods smooth towards the same surface
+/// are symmetric and factorized once (sparse LDLT), so a step costs two triangular solves
+/// the factorization only depends on the mesh, the weights, the locked vertices and t, so it is meant to be kept
+/// next to the weights and reused for all steps and smoothing runs until one of them changes
+struct implicit_smoother
+{
+    implicit_smoother();
+    implicit_smoother(pm::Mesh const& mesh,
+                      pm::edge_attribute<float> const& edge_weight,
+                      pm::vertex_attribute<bool> const& locked,
+                      bool bilaplacian,
+                      float time_step);
+    ~implicit_smoother();
+
+    implicit_smoother(implicit_smoother&&) noexcept;
+    implicit_smoother& operator=(implicit_smoother&&) noexcept;
+
+    /// false if not built or the factorization failed
+    bool is_valid() const;
+    float time_step() const { return _time_step; }
+
+    /// performs the given number of backward Euler steps on the free vertices
+    void smooth(pm::vertex_attribute<tg::pos3>& position, int steps) const;
+
+private:
+    struct factorization;
+    std::unique_ptr<factorization> _factorization;
+    float _time_step = 0;
+};
+}
@@ -0,0 +1,272 @@
+#include "laplacian.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include <typed-geometry/tg.hh>
+
+#include <common/parallel_chunks.hh>
+
+namespace
+{
+// the second pass of the bi-Laplacian over a chunk of rows reads the Laplace vectors of the chunks that contain the
+// free neighbors of its rows (its dependencies, including itself)
+// the dependents of chunk c are dependents[offsets[c]] .. dependents[offsets[c + 1] - 1]
+struct chunk_dependencies
+{
+    std::vector<int> offsets = {0};    ///< one entry per chunk plus one
+    std::vector<int> dependents;       ///< chunks whose second pass reads the Laplace vectors of a chunk
+    std::vector<int> num_dependencies; ///< per chunk
+
+    chunk_dependencies() = default;
+    explicit chunk_dependencies(gp::laplacian_operator const& laplacian)
+    {
+        auto const num_rows = laplacian.num_rows();
+        auto const n = gp::num_chunks(num_rows);
+        std::vector<int> chunk_of(laplacian.num_vertices, -1);
+        for (auto r = 0; r < num_rows; ++r)
+            chunk_of[laplacian.rows[r]] = r / gp::row_chunk_size;
+
+        // (dependency, chunk) pairs, counting sorted by dependency, seen[d] == c marks d as found for chunk c
+        std::vector<std::pair<int, int>> pairs;
+        std::vector<int> seen(n, -1);
+        num_dependencies.resize(n);
+        for (auto c = 0; c < n; ++c)
+        {
+            auto const add = [&](int d) {
+                if (d < 0 || seen[d] == c)
+                    return;
+                seen[d] = c;
+                pairs.emplace_back(d, c);
+                ++num_dependencies[c];
+            };
+            add(c);
+            auto const end = std::min(num_rows, (c + 1) * gp::row_chunk_size);
+            for (auto k = laplacian.offsets[c * gp::row_chunk_size]; k < laplacian.offsets[end]; ++k)
+                add(chunk_of[laplacian.neighbors[k]]);
+        }
+
+        offsets.resize(n + 1);
+        for (auto const& [d, c] : pairs)
+            ++offsets[d + 1];
+        for (auto d = 0; d < n; ++d)
+            offsets[d + 1] += offsets[d];
+        dependents.resize(pairs.size());
+        auto next = offsets;
+        for (auto const& [d, c] : pairs)
+            dependents[next[d]++] = c;
+    }
+};
+}
+
+gp::convergence_info gp::smooth_jacobi(laplacian_operator const& laplacian,
+                                       pm::vertex_attribute<tg::pos3>& position,
+                                       bool bilaplacian,
+                                       stopping_rule const& rule,
+                                       bool parallel)
+{
+    auto const n = laplacian.num_vertices;
+    auto const num_rows = laplacian.num_rows();
+    auto const rows = laplacian.rows.data();
+
+    // locked vertices are never written, so they hold their position in both buffers
+    std::vector<tg::vec4> current(n);
+    for (auto i = 0; i < n; ++i)
+        current[i] = tg::vec4(tg::vec3(position.data()[i]), 0);
+    auto next = current;
+    std::vector<tg::vec4> laplace(bilaplacian ? n : 0); // zero for locked vertices
+
+    // bi-Laplacian: both passes run in one sweep over the chunks, the second pass of a chunk is run by whichever chunk
+    // finishes the last of its dependencies, right after computing its Laplace vectors, so they are still in cache
+    // (for meshes whose vertex order is local, that is the next chunk)
+    // remaining[c] counts the dependencies of chunk c whose Laplace vectors are not computed yet in this iteration
+    auto const dependencies = bilaplacian ? chunk_dependencies(laplacian) : chunk_dependencies();
+    std::vector<std::atomic<int>> remaining(dependencies.num_dependencies.size());
+    std::vector<residual_accumulator> partial(dependencies.num_dependencies.size());
+
+    // the (x, y, z, 0) lanes of a row are accumulated together by the shared row kernel
+    convergence_info info;
+    while (info.iterations < rule.max_iterations && !info.converged)
+    {
+        auto const in = current.data();
+        auto const out = next.data();
+
+        residual_accumulator residual;
+        if (!bilaplacian)
+        {
+            residual = for_chunks(num_rows, parallel, [&](int begin, int end, residual_accumulator& res) {
+                for (auto r = begin; r < end; ++r)
+                {
+                    auto const d = 0.5f * laplacian.apply_row(in, r);
+                    out[rows[r]] = in[rows[r]] + d;
+                    res.add(tg::dot(d, d));
+                }
+            });
+        }
+        else
+        {
+            auto const l = laplace.data();
+            auto const second_pass = [&](int c) {
+                residual_accumulator res;
+                for (auto r = c * row_chunk_size; r < std::min(num_rows, (c + 1) * row_chunk_size); ++r)
+                {
+                    auto const d = -0.25f * laplacian.apply_row(l, r);
+                    out[rows[r]] = in[rows[r]] + d;
+                    res.add(tg::dot(d, d));
+                }
+                partial[c] = res;
+            };
+
+            for (auto c = 0u; c < remaining.size(); ++c)
+                remaining[c].store(dependencies.num_dependencies[c], std::memory_order_relaxed);
+            run_chunks(num_rows, parallel, [&](int begin, int end) {
+                for (auto r = begin; r < end; ++r)
+                    l[rows[r]] = laplacian.apply_row(in, r);
+
+                // the acquire-release decrement publishes the Laplace vectors to the thread that runs the second pass
+                auto const c = begin / row_chunk_size;
+                for (auto k = dependencies.offsets[c]; k < dependencies.offsets[c + 1]; ++k)
+                    if (auto const d = dependencies.dependents[k]; remaining[d].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        second_pass(d);
+            });
+            residual = merge_residuals(partial);
+        }
+
+        std::swap(current, next);
+        ++info.iterations;
+        info.residual = residual.residual(rule.residual_norm);
+        info.converged = info.residual <= rule.tolerance;
+    }
+
+    for (auto i = 0; i < n; ++i)
+        position.data()[i] = tg::pos3(current[i].x, current[i].y, current[i].z);
+    return info;
+}
+
+gp::row_coloring::row_coloring(laplacian_operator const& laplacian, int distance)
+{
+    auto const num_rows = laplacian.num_rows();
+    std::vector<int> row_of(laplacian.num_vertices, -1);
+    for (auto r = 0; r < num_rows; ++r)
+        row_of[laplacian.rows[r]] = r;
+
+    // greedy: smallest color not used within the distance, forbidden[c] == r marks color c as taken for row r
+    std::vector<int> color(num_rows, -1);
+    std::vector<int> forbidden;
+    std::vector<int> count;
+    auto const forbid_neighbors = [&](int r, int self) {
+        for (auto k = laplacian.offsets[r]; k < laplacian.offsets[r + 1]; ++k)
+            if (auto const j = row_of[laplacian.neighbors[k]]; j >= 0 && color[j] >= 0)
+                forbidden[color[j]] = self;
+    };
+    for (auto r = 0; r < num_rows; ++r)
+    {
+        forbid_neighbors(r, r);
+        if (distance >= 2)
+            for (auto k = laplacian.offsets[r]; k < laplacian.offsets[r + 1]; ++k)
+                if (auto const j = row_of[laplacian.neighbors[k]]; j >= 0)
+                    forbid_neighbors(j, r);
+
+        auto c = 0;
+        while (c < int(forbidden.size()) && forbidden[c] == r)
+            ++c;
+        if (c == int(forbidden.size()))
+        {
+            forbidden.push_back(-1);
+            count.push_back(0);
+        }
+        color[r] = c;
+        ++count[c];
+    }
+
+    // counting sort by color, rows stay in index order within a color
+    offsets.resize(count.size() + 1);
+    for (auto c = 0u; c < count.size(); ++c)
+        offsets[c + 1] = offsets[c] + count[c];
+    rows.resize(num_rows);
+    auto next = offsets;
+    for (auto r = 0; r < num_rows; ++r)
+        rows[next[color[r]]++] = r;
+}
+
+gp::convergence_info gp::smooth_gauss_seidel(laplacian_operator const& laplacian,
+                                             row_coloring const& coloring,
+                                             pm::vertex_attribute<tg::pos3>& position,
+                                             bool bilaplacian,
+                                             stopping_rule const& rule,
+                                             bool parallel)
+{
+    auto const x = position.data();
+    auto const rows = laplacian.rows.data();
+    auto const offsets = laplacian.offsets.data();
+    auto const neighbors = laplacian.neighbors.data();
+    auto const weights = laplacian.weights.data();
+
+    // the Laplacian of a locked vertex is zero
+    std::vector<int> row_of(bilaplacian ? laplacian.num_vertices : 0, -1);
+    if (bilaplacian)
+        for (auto r = 0; r < laplacian.num_rows(); ++r)
+            row_of[rows[r]] = r;
+
+    // every vertex is moved such that its own equation L(x)_i = 0 or L(L(x))_i = 0 holds for the current neighbors
+    // (no damping needed, unlike Jacobi), for the bi-Laplacian the coefficient of x_i is 1 + sum_j w_ij w_ji
+    auto const update = [&](int begin, int end, int const* color_rows, residual_accumulator& res) {
+        for (auto c = begin; c < end; ++c)
+        {
+            auto const r = color_rows[c];
+            auto const i = rows[r];
+            if (!bilaplacian)
+            {
+                auto const d = laplacian.apply_row(x, r);
+                x[i] += d;
+                res.add(tg::dot(d, d));
+                continue;
+            }
+
+            auto const li = laplacian.apply_row(x, r);
+            auto u = tg::vec3::zero;
+            auto diagonal = 1.0f;
+            for (auto k = offsets[r]; k < offsets[r + 1]; ++k)
+            {
+                auto const j = row_of[neighbors[k]];
+                if (j < 0)
+                {
+                    u -= weights[k] * li;
+                    continue;
+                }
+
+                auto const xj = x[rows[j]];
+                auto lj = tg::vec3::zero;
+                for (auto l = offsets[j]; l < offsets[j + 1]; ++l)
+                {
+                    lj += weights[l] * (x[neighbors[l]] - xj);
+                    if (neighbors[l] == i)
+                        diagonal += weights[k] * weights[l];
+                }
+                u += weights[k] * (lj - li);
+            }
+            auto const d = -u / diagonal;
+            x[i] += d;
+            res.add(tg::dot(d, d));
+        }
+    };
+
+    convergence_info info;
+    while (info.iterations < rule.max_iterations && !info.converged)
+    {
+        residual_accumulator residual;
+        for (auto c = 0; c < coloring.num_colors(); ++c)
+        {
+            auto const color_rows = coloring.rows.data() + coloring.offsets[c];
+            auto const size = coloring.offsets[c + 1] - coloring.offsets[c];
+            residual.merge(for_chunks(size, parallel, [&](int begin, int end, residual_accumulator& res) { update(begin, end, color_rows, res); }));
+        }
+
+        ++info.iterations;
+        info.residual = residual.residual(rule.residual_norm);
+        info.converged = info.residual <= rule.tolerance;
+    }
+    return info;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <typed-geometry/tg-lean.hh>
+
+#include <common/convergence.hh>
+#include <common/laplacian_operator.hh>
+
+namespace gp
+{
+/// explicit Jacobi smoothing, per iteration x' = x + 0.5 L(x) or, for the bi-Laplacian, x' = x - 0.25 L(L(x))
+/// the positions live in two padded (x, y, z, 0) buffers that are swapped after every iteration, so the three
+/// coordinates are accumulated in one SIMD lane each, and the rows are processed in chunks on the global thread pool
+/// every row performs the same operations in the same order no matter which thread runs it,
+/// so the result is bit-identical for any number of threads and to the serial version (parallel = false)
+/// the displacement of every row is accumulated in the same sweep and checked against the stopping rule
+/// for the bi-Laplacian, both Laplacians are computed in one sweep over the chunks: the second pass of a chunk runs
+/// as soon as the Laplace vectors it reads are computed, while they are still in cache
+convergence_info smooth_jacobi(laplacian_operator const& laplacian,
+                               pm::vertex_attribute<tg::pos3>& position,
+                               bool bilaplacian,
+                               stopping_rule const& rule,
+                               bool parallel = true);
+
+/// rows of a laplacian_operator grouped into independent sets by greedy graph coloring:
+/// rows of the same color are more than `distance` hops apart (over the neighbor lists),
+/// the rows of color c are rows[offsets[c]] .. rows[offsets[c + 1] - 1]
+struct row_coloring
+{
+    std::vector<int> rows;          ///< row indices (not vertex indices), grouped by color
+    std::vector<int> offsets = {0}; ///< one entry per color plus one
+
+    row_coloring() = default;
+    row_coloring(laplacian_operator const& laplacian, int distance);
+
+    int num_colors() const { return int(offsets.size()) - 1; }
+    bool empty() const { return rows.empty(); }
+};
+
+/// in-place Gauss-Seidel smoothing: every free vertex is moved such that L(x)_i = 0 (or L(L(x))_i = 0 for the
+/// bi-Laplacian) given the latest positions of its neighbors, so it needs a single position buffer and converges to
+/// the same harmonic (biharmonic) surface as smooth_jacobi in roughly half the sweeps
+/// the colors are processed one after another, the rows of one color in parallel on the global thread pool
+/// the coloring must have distance 1 for the Laplacian and distance 2 for the bi-Laplacian (L(L(x))_i reads the 2-ring),
+/// then no row reads a position written by another row of the same color and the result is independent of the threads
+convergence_info smooth_gauss_seidel(laplacian_operator const& laplacian,
+                                     row_coloring const& coloring,
+                                     pm::vertex_attribute<tg::pos3>& position,
+                                     bool bilaplacian,
+                                     stopping_rule const& rule,
+                                     bool parallel = true);
+}
@@ -10,6 +10,10 @@
 #include <polymesh/formats.hh>
 #include <typed-geometry/tg.hh>
 
+#include <common/multigrid.hh>
+
+#include "implicit_smoothing.hh"
+#include "laplacian.hh"
 #include "task.hh"
 
 namespace gp
@@ -29,6 +33,11 @@ struct Versions
     bool bilaplacian;
     decltype(gv::make_renderable(positions)) positions_r;
     decltype(gv::make_renderable(gv::lines(positions))) wireframe_r;
+    gp::implicit_smoother implicit; ///< factorized for weights, locked and the current time step
+    gp::laplacian_operator laplacian; ///< for Gauss-Seidel, built on first use after loading
+    gp::row_coloring coloring;
+    gp::multigrid_solver multigrid; ///< hierarchy for weights and locked, built on first use after loading
+    gp::convergence_info convergence; ///< of the last iterative smoothing
 };
 
 }
@@ -41,6 +50,8 @@ int main(int /*argc*/, char** /*args*/)
     pm::Mesh mesh;
     // the vertex positions
     pm::vertex_attribute<tg::pos3> position_initial(mesh);
+    // cotangents of position_initial, shared by the cotan versions
+    gp::cotan_weight_cache cotan(position_initial);
 
     tg::aabb3 aabb;
 
@@ -62,6 +73,11 @@ int main(int /*argc*/, char** /*args*/)
     int current_model = 0;
     int num_iterations = 1;
     bool show_wireframe = false;
+    int method = 0;
+    char const* methods[] = {"Jacobi", "Gauss-Seidel", "Implicit", "Multigrid"};
+    float time_step = 10;
+    float tolerance = 0;
+    bool rms_residual = false;
 
     auto const lock_vertices = [&](gp::Versions& v) {
         // always lock boundary
@@ -88,13 +104,18 @@ int main(int /*argc*/, char** /*args*/)
             p = tg::pos3(-p.y, -p.z, p.x);
         }
         aabb = tg::aabb_of(position_initial);
+        cotan.mark_stale();
         for (auto& ver : versions)
         {
             ver.positions = position_initial;
             ver.positions_r = gv::make_renderable(ver.positions);
             ver.wireframe_r = gv::make_renderable(gv::lines(ver.positions).line_width_world(0.005));
-            ver.weights = task::compute_weights(mesh, position_initial, ver.cotan);
+            ver.weights = task::compute_weights(mesh, cotan, ver.cotan);
             lock_vertices(ver);
+            ver.implicit = {};
+            ver.coloring = {};
+            ver.multigrid = {};
+            ver.convergence = {};
         }
     };
     load(filenames[0]);
@@ -103,21 +124,60 @@ int main(int /*argc*/, char** /*args*/)
         ImGui::Begin("Smoothing");
         auto data_changed = ImGui::Combo("Data", &current_model, filenames, 4);
         ImGui::InputInt("# iterations", &num_iterations);
+        ImGui::Combo("Method", &method, methods, 4);
+        if (method == 2)
+            ImGui::InputFloat("Time Step", &time_step);
+        else
+        {
+            ImGui::InputFloat("Tolerance", &tolerance, 0, 0, "%g");
+            ImGui::Checkbox("RMS Residual", &rms_residual);
+        }
         auto wireframe_changed = ImGui::Checkbox("Show Wireframe", &show_wireframe);
         auto positions_changed = false;
         if (ImGui::Button("Smooth"))
         {
             std::cout << "Smoothing" << std::endl;
+            // iterative methods stop early once the displacement of an iteration is within the tolerance
+            auto const rule = gp::stopping_rule(num_iterations, tolerance, rms_residual ? gp::stopping_rule::norm::rms : gp::stopping_rule::norm::max);
             for (auto& ver : versions)
             {
-                auto edge_weight = task::compute_weights(mesh, position_initial, ver.cotan);
-                task::compute_new_positions(mesh, ver.positions, edge_weight, ver.locked, !ver.bilaplacian, num_iterations);
+                ver.convergence = {};
+                if (method == 1)
+                {
+                    // in place, colors of independent vertices one after another
+                    if (ver.coloring.empty())
+                    {
+                        ver.laplacian = gp::laplacian_operator(mesh, ver.weights, ver.locked);
+                        ver.coloring = gp::row_coloring(ver.laplacian, ver.bilaplacian ? 2 : 1);
+                    }
+                    ver.convergence = gp::smooth_gauss_seidel(ver.laplacian, ver.coloring, ver.positions, ver.bilaplacian, rule);
+                }
+                else if (method == 2)
+                {
+                    // one backward Euler step per iteration, factorized only for a new mesh or time step
+                    if (!ver.implicit.is_valid() || ver.implicit.time_step() != time_step)
+                        ver.implicit = gp::implicit_smoother(mesh, ver.weights, ver.locked, ver.bilaplacian, time_step);
+                    ver.implicit.smooth(ver.positions, num_iterations);
+                }
+                else if (method == 3)
+                {
+                    // one V-cycle per iteration straight towards the steady state of the iterative methods, the
+                    // harmonic surface (also for the bi-Laplacian: the Laplacian of the locked vertices is zero)
+                    if (!ver.multigrid.is_valid())
+                        ver.multigrid = gp::multigrid_solver(position_initial, ver.weights, ver.locked);
+                    ver.convergence = ver.multigrid.solve(ver.positions, rule);
+                }
+                else // the weights only depend on position_initial, they were computed when loading
+                    ver.convergence = task::compute_new_positions(mesh, ver.positions, ver.weights, ver.locked, !ver.bilaplacian, rule);
                 ver.positions_r = gv::make_renderable(ver.positions);
                 ver.wireframe_r = gv::make_renderable(gv::lines(ver.positions).line_width_world(0.005));
             }
             positions_changed = true;
         }
         data_changed |= (ImGui::Button("Reset"));
+        for (auto const& ver : versions)
+            if (ver.convergence.iterations > 0)
+                ImGui::Text("%s: %d iterations, residual %g", ver.name.c_str(), ver.convergence.iterations, ver.convergence.residual);
         ImGui::End();
 
         if (data_changed)
@@ -1,11 +1,23 @@
 #include <polymesh/Mesh.hh>
 #include <typed-geometry/tg-lean.hh>
 
+#include <common/convergence.hh>
+#include <common/cotan_weights.hh>
+
 namespace task
 {
 
 pm::edge_attribute<float> compute_weights(pm::Mesh& mesh, pm::vertex_attribute<tg::pos3>& position, bool cotan_weights);
 
-void compute_new_positions(pm::Mesh& mesh, pm::vertex_attribute<tg::pos3>& position, const pm::edge_attribute<float>& edge_weight, const pm::vertex_attribute<bool>& locked, bool simple_laplace, int iterations);
+/// same as above, but the cotangents come from a cache that is only recomputed after the positions changed
+pm::edge_attribute<float> compute_weights(pm::Mesh& mesh, gp::cotan_weight_cache& cotan, bool cotan_weights);
+
+/// runs up to rule.max_iterations smoothing iterations, stops early once an iteration moved the vertices by at most rule.tolerance
+gp::convergence_info compute_new_positions(pm::Mesh& mesh,
+                                           pm::vertex_attribute<tg::pos3>& position,
+                                           const pm::edge_attribute<float>& edge_weight,
+                                           const pm::vertex_attribute<bool>& locked,
+                                           bool simple_laplace,
+                                           gp::stopping_rule const& rule);
 
 }
@@ -8,6 +8,8 @@
 #include <polymesh/formats.hh>
 #include <typed-geometry/tg-lean.hh>
 
+#include <common/multigrid.hh>
+
 #include "task.hh"
 
 namespace
@@ -33,6 +35,8 @@ int main(int /*argc*/, char** /*args*/)
     pm::vertex_attribute<tg::pos2> texture_coordinates(mesh);
     // edge weights (uniform / cotangent)
     pm::edge_attribute<float> edge_weight(mesh);
+    // cotangents of position, recomputed only when a mesh is loaded
+    gp::cotan_weight_cache cotan(position);
     // parameter domain as color attribute
     pm::vertex_attribute<tg::color3> paramter_color(mesh);
     // use world x and y as texture coordinate
@@ -73,6 +77,11 @@ int main(int /*argc*/, char** /*args*/)
     const char* weight_type_name[] = {"uniform", "cotangent"};
     int selected_mesh_idx = 0;
     int iterations = 10;
+    float tolerance = 0;
+    bool rms_residual = false;
+    gp::convergence_info convergence; // of the last smoothing
+    // for the current mesh and weights, built on first use
+    gp::multigrid_solver multigrid;
 
     // update renderables whenever they are changed
     auto update_renderables = [&]() {
@@ -114,7 +123,9 @@ int main(int /*argc*/, char** /*args*/)
         task::init_texture_coordinates(position, texture_coordinates);
         for (auto const v : mesh.vertices())
             texture_from_world[v] = {position[v].x, position[v].y};
-        task::compute_weights(selected_weight_type, position, edge_weight);
+        cotan.mark_stale();
+        task::compute_weights(selected_weight_type, cotan, edge_weight);
+        multigrid = {};
     };
 
     load_mesh(mesh_filenames[selected_mesh_idx]);
@@ -132,22 +143,37 @@ int main(int /*argc*/, char** /*args*/)
         }
         if (ImGui::Combo("Weight Type", reinterpret_cast<int*>(&selected_weight_type), weight_type_name, 2))
         {
-            task::compute_weights(selected_weight_type, position, edge_weight);
+            task::compute_weights(selected_weight_type, cotan, edge_weight);
+            multigrid = {};
         }
         ImGui::InputInt("Iterations", &iterations);
+        ImGui::InputFloat("Tolerance", &tolerance, 0, 0, "%g");
+        ImGui::Checkbox("RMS Residual", &rms_residual);
         if (ImGui::Button("Restart"))
         {
             task::init_texture_coordinates(position, texture_coordinates);
             changed |= true;
         }
+        auto const rule = gp::stopping_rule(iterations, tolerance, rms_residual ? gp::stopping_rule::norm::rms : gp::stopping_rule::norm::max);
         if (ImGui::Button("Smooth"))
         {
-            task::smooth_texcoords(mesh, iterations, edge_weight, texture_coordinates);
+            convergence = task::smooth_texcoords(mesh, rule, edge_weight, texture_coordinates);
+            changed |= true;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Multigrid"))
+        {
+            // V-cycles instead of relaxation iterations, towards the same harmonic map with the boundary fixed
+            if (!multigrid.is_valid())
+                multigrid = gp::multigrid_solver(position, edge_weight, mesh.vertices().map([](pm::vertex_handle v) { return v.is_boundary(); }));
+            convergence = multigrid.solve(texture_coordinates, rule);
             changed |= true;
         }
+        if (convergence.iterations > 0)
+            ImGui::Text("%d iterations, residual %g", convergence.iterations, convergence.residual);
         if (ImGui::Button("Parametrize"))
         {
-            task::direct_solve(position, edge_weight, selected_weight_type, texture_coordinates);
+            task::direct_solve(position, edge_weight, texture_coordinates);
             changed |= true;
         }
 
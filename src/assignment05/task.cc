@@ -81,11 +81,15 @@ void init_texture_coordinates(pm::vertex_attribute<tg::pos3> const& position, pm
     //================================================================
 }
 
-void smooth_texcoords(pm::Mesh const& m, int iterations, pm::edge_attribute<float> const& weight, pm::vertex_attribute<tg::pos2>& texture_coordinate)
+gp::convergence_info smooth_texcoords(pm::Mesh const& m, gp::stopping_rule const& rule, pm::edge_attribute<float> const& weight, pm::vertex_attribute<tg::pos2>& texture_coordinate)
 {
     auto new_texture_coordinate = texture_coordinate;
-    for (auto i = 0; i < iterations; ++i)
+    gp::convergence_info info;
+    while (info.iterations < rule.max_iterations && !info.converged)
     {
+        // displacement of the interior vertices in this iteration
+        gp::residual_accumulator residual;
+
         for (auto v : m.vertices())
         {
             // INSERT CODE:
@@ -118,55 +122,38 @@ void smooth_texcoords(pm::Mesh const& m, int iterations, pm::edge_attribute<floa
             }
             // compute the new texture coordinates
             new_texture_coordinate[v] = texture_coordinate[v] + (sum_weighted_texcoords / sum_weights);
+            residual.add(tg::distance_sqr(new_texture_coordinate[v], texture_coordinate[v]));
 
             //================================================================================
             //--- end strip ---
             //================================================================================
         }
         texture_coordinate = new_texture_coordinate;
+
+        ++info.iterations;
+        info.residual = residual.residual(rule.residual_norm);
+        info.converged = info.residual <= rule.tolerance;
     }
+    return info;
 }
 
 void compute_weights(gp::weight_type type, pm::vertex_attribute<tg::pos3> const& position, pm::edge_attribute<float>& edge_weight)
 {
-    auto const& m = edge_weight.mesh();
+    gp::cotan_weight_cache cotan(position);
+    compute_weights(type, cotan, edge_weight);
+}
 
+void compute_weights(gp::weight_type type, gp::cotan_weight_cache& cotan, pm::edge_attribute<float>& edge_weight)
+{
     // Uniform weighting
     if (type == gp::weight_type::uniform)
     {
         edge_weight.clear(1.0);
     }
-    // Cotangent weighting
+    // Cotangent weighting: cot alpha_ij + cot beta_ij
     else if (type == gp::weight_type::cotangent)
     {
-        for (auto e : m.edges())
-        {
-            float w = 0.0f;
-
-            auto h0 = e.halfedgeA();
-            auto v0 = h0.vertex_to();
-            auto p0 = position(v0);
-
-            auto h1 = e.halfedgeB();
-            auto v1 = h1.vertex_to();
-            auto p1 = position(v1);
-
-            auto h2 = h0.next();
-            auto v2 = h2.vertex_to();
-            auto p2 = position(v2);
-
-            auto d0 = normalize(p0 - p2);
-            auto d1 = normalize(p1 - p2);
-            w += 1.0f / tg::tan(tg::acos(dot(d0, d1)));
-
-            h2 = h1.next();
-            p2 = position(h2.vertex_to());
-            d0 = normalize(p0 - p2);
-            d1 = normalize(p1 - p2);
-            w += 1.0f / tg::tan(tg::acos(dot(d0, d1)));
-
-            edge_weight[e] = w;
-        }
+        edge_weight.copy_from(cotan.weights());
     }
 }
 
@@ -225,16 +212,13 @@ void add_row_to_system(std::vector<Eigen::Triplet<float>>& triplets,
     //================================================================================
 }
 
-void direct_solve(pm::vertex_attribute<tg::pos3> const& position, pm::edge_attribute<float>& edge_weight, gp::weight_type type, pm::vertex_attribute<tg::pos2>& texture_coordinate)
+void direct_solve(pm::vertex_attribute<tg::pos3> const& position, pm::edge_attribute<float> const& edge_weight, pm::vertex_attribute<tg::pos2>& texture_coordinate)
 {
     auto const& m = position.mesh();
 
     // make sure the boundary has been mapped to a circle (we need these texcoords in add_row_to_system_matrix)
     init_texture_coordinates(position, texture_coordinate);
 
-    // also make sure the weights have been computed
-    compute_weights(type, position, edge_weight);
-
     auto sysid = m.vertices().make_attribute<int>();
     int n_boundary = 0;
     int n_inner = 0;
@@ -1,6 +1,9 @@
 #include <polymesh/Mesh.hh>
 #include <typed-geometry/tg-lean.hh>
 
+#include <common/convergence.hh>
+#include <common/cotan_weights.hh>
+
 namespace gp
 {
 enum weight_type
@@ -14,6 +17,10 @@ namespace task
 {
 void init_texture_coordinates(pm::vertex_attribute<tg::pos3> const& position, pm::vertex_attribute<tg::pos2>& texture_coordintate);
 void compute_weights(gp::weight_type type, pm::vertex_attribute<tg::pos3> const& position, pm::edge_attribute<float>& edge_weight);
-void direct_solve(pm::vertex_attribute<tg::pos3> const& position, pm::edge_attribute<float>& edge_weight, gp::weight_type type, pm::vertex_attribute<tg::pos2>& texture_coordinate);
-void smooth_texcoords(pm::Mesh const& m, int iterations, pm::edge_attribute<float> const& weight, pm::vertex_attribute<tg::pos2>& texture_coordinate);
+/// same as above, but the cotangents come from a cache that is only recomputed after the positions changed
+void compute_weights(gp::weight_type type, gp::cotan_weight_cache& cotan, pm::edge_attribute<float>& edge_weight);
+/// edge_weight has to be up to date (see compute_weights)
+void direct_solve(pm::vertex_attribute<tg::pos3> const& position, pm::edge_attribute<float> const& edge_weight, pm::vertex_attribute<tg::pos2>& texture_coordinate);
+/// runs up to rule.max_iterations relaxation iterations, stops early once an iteration moved the texture coordinates by at most rule.tolerance
+gp::convergence_info smooth_texcoords(pm::Mesh const& m, gp::stopping_rule const& rule, pm::edge_attribute<float> const& weight, pm::vertex_attribute<tg::pos2>& texture_coordinate);
 }
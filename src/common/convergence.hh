@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cmath>
+
+namespace gp
+{
+/// stopping rule of an iterative kernel: at most max_iterations, but stop as soon as one iteration moved the
+/// unknowns by at most tolerance, measured as the largest or the root mean square displacement
+/// implicitly constructible from an iteration count (tolerance 0: stops only once nothing moves anymore)
+struct stopping_rule
+{
+    enum class norm
+    {
+        max,
+        rms
+    };
+
+    int max_iterations = 1;
+    float tolerance = 0;
+    norm residual_norm = norm::max;
+
+    stopping_rule() = default;
+    stopping_rule(int max_iterations, float tolerance = 0, norm residual_norm = norm::max)
+      : max_iterations(max_iterations), tolerance(tolerance), residual_norm(residual_norm)
+    {
+    }
+};
+
+/// what an iterative kernel did: iterations used and the displacement of the last one
+struct convergence_info
+{
+    int iterations = 0;
+    float residual = 0;
+    bool converged = false; ///< stopped because the residual reached the tolerance
+};
+
+/// accumulates the displacements of one iteration, one per unknown (kernels keep one per chunk and merge them)
+struct residual_accumulator
+{
+    double max_sqr = 0;
+    double sum_sqr = 0;
+    int count = 0;
+
+    void add(double displacement_sqr)
+    {
+        update_max(displacement_sqr);
+        sum_sqr += displacement_sqr;
+        ++count;
+    }
+
+    void merge(residual_accumulator const& rhs)
+    {
+        update_max(rhs.max_sqr);
+        sum_sqr += rhs.sum_sqr;
+        count += rhs.count;
+    }
+
+    float residual(stopping_rule::norm n) const
+    {
+        if (n == stopping_rule::norm::max)
+            return float(std::sqrt(max_sqr));
+        return count == 0 ? 0.0f : float(std::sqrt(sum_sqr / count));
+    }
+
+private:
+    // a diverged (NaN) displacement must not be hidden by std::max
+    void update_max(double d)
+    {
+        if (!std::isnan(max_sqr) && !(d <= max_sqr))
+            max_sqr = d;
+    }
+};
+}
@@ -0,0 +1,90 @@
+#include "cotan_weights.hh"
+
+#include <cmath>
+
+#include <typed-geometry/tg.hh>
+
+namespace
+{
+// faces per block, the buffers of a block stay in L1
+constexpr int block_size = 256;
+}
+
+void gp::compute_cotan_weights(pm::vertex_attribute<tg::pos3> const& position, pm::edge_attribute<float>& edge_weight)
+{
+    auto const& m = position.mesh();
+    edge_weight.clear(0.0f);
+
+    // corner k of a face is the one opposite of its k-th halfedge,
+    // the k-th halfedge runs from corner k + 1 to corner k + 2
+    float x[3][block_size];
+    float y[3][block_size];
+    float z[3][block_size];
+    float cot[3][block_size];
+    int edge[3][block_size];
+
+    auto const flush = [&](int count) {
+        for (auto k = 0; k < 3; ++k)
+        {
+            auto const k1 = (k + 1) % 3;
+            auto const k2 = (k + 2) % 3;
+            for (auto i = 0; i < count; ++i)
+            {
+                auto const ax = x[k1][i] - x[k][i];
+                auto const ay = y[k1][i] - y[k][i];
+                auto const az = z[k1][i] - z[k][i];
+                auto const bx = x[k2][i] - x[k][i];
+                auto const by = y[k2][i] - y[k][i];
+                auto const bz = z[k2][i] - z[k][i];
+
+                auto const dot = ax * bx + ay * by + az * bz;
+                auto const cx = ay * bz - az * by;
+                auto const cy = az * bx - ax * bz;
+                auto const cz = ax * by - ay * bx;
+                auto const cross_length = std::sqrt(cx * cx + cy * cy + cz * cz);
+                cot[k][i] = cross_length > 0 ? dot / cross_length : 0.0f;
+            }
+        }
+
+        for (auto i = 0; i < count; ++i)
+            for (auto k = 0; k < 3; ++k)
+                edge_weight.data()[edge[k][i]] += cot[k][i];
+    };
+
+    auto count = 0;
+    for (auto const f : m.faces())
+    {
+        auto h = f.any_halfedge();
+        for (auto k = 0; k < 3; ++k)
+        {
+            auto const p = position[h.prev().vertex_from()]; // the corner opposite of h
+            x[k][count] = p.x;
+            y[k][count] = p.y;
+            z[k][count] = p.z;
+            edge[k][count] = h.edge().idx.value;
+            h = h.next();
+        }
+
+        if (++count == block_size)
+        {
+            flush(count);
+            count = 0;
+        }
+    }
+    flush(count);
+}
+
+gp::cotan_weight_cache::cotan_weight_cache(pm::vertex_attribute<tg::pos3> const& position)
+  : _position(&position), _weights(position.mesh().edges().make_attribute<float>())
+{
+}
+
+pm::edge_attribute<float> const& gp::cotan_weight_cache::weights()
+{
+    if (_stale)
+    {
+        compute_cotan_weights(*_position, _weights);
+        _stale = false;
+    }
+    return _weights;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <polymesh/Mesh.hh>
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+/// cotangent weights of a triangle mesh: every edge gets cot(alpha) + cot(beta) of the two angles opposite of it
+/// (only one for boundary edges), the weights of the Laplace-Beltrami operator up to a factor of 1/2
+/// computed face by face: the three corner cotangents dot(a, b) / |cross(a, b)| (no trigonometry) are evaluated
+/// in blocks of faces over structure-of-arrays buffers (vectorizable) and then scattered to the edges
+/// degenerate corners contribute zero
+void compute_cotan_weights(pm::vertex_attribute<tg::pos3> const& position, pm::edge_attribute<float>& edge_weight);
+
+/// cotangent weights kept next to a mesh: computed on first use and reused until mark_stale() is called,
+/// which has to happen whenever the positions (or the topology) change
+struct cotan_weight_cache
+{
+    explicit cotan_weight_cache(pm::vertex_attribute<tg::pos3> const& position);
+
+    /// weights as in compute_cotan_weights, recomputed only if stale
+    pm::edge_attribute<float> const& weights();
+
+    void mark_stale() { _stale = true; }
+    bool is_stale() const { return _stale; }
+
+private:
+    pm::vertex_attribute<tg::pos3> const* _position;
+    pm::edge_attribute<float> _weights;
+    bool _stale = true;
+};
+}
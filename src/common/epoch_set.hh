@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace gp
+{
+/// set of indices in [0, size) with O(1) clear
+/// every index stores the epoch in which it was last inserted, clearing just starts a new epoch,
+/// so an instance that is kept across calls costs nothing per index that is not touched
+struct epoch_set
+{
+    /// empties the set and makes room for indices in [0, size)
+    void clear(int size)
+    {
+        if (int(_stamps.size()) < size)
+            _stamps.resize(size, 0);
+
+        if (++_epoch == 0) // wrapped around, stamps of old epochs could collide
+        {
+            std::fill(_stamps.begin(), _stamps.end(), 0);
+            _epoch = 1;
+        }
+    }
+
+    bool contains(int i) const { return _stamps[i] == _epoch; }
+
+    /// returns false if i was already contained
+    bool insert(int i)
+    {
+        if (_stamps[i] == _epoch)
+            return false;
+        _stamps[i] = _epoch;
+        return true;
+    }
+
+private:
+    std::vector<std::uint32_t> _stamps;
+    std::uint32_t _epoch = 0;
+};
+}
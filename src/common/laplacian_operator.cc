@@ -0,0 +1,28 @@
+#include "laplacian_operator.hh"
+
+gp::laplacian_operator::laplacian_operator(pm::Mesh const& mesh, pm::edge_attribute<float> const& edge_weight, pm::vertex_attribute<bool> const& locked)
+{
+    num_vertices = mesh.all_vertices().size();
+
+    for (auto const v : mesh.vertices())
+    {
+        if (locked[v])
+            continue;
+
+        auto weight_sum = 0.0f;
+        for (auto const h : v.outgoing_halfedges())
+            weight_sum += edge_weight[h.edge()];
+
+        // no (or only zero-weight) neighbors: the vertex does not move
+        if (weight_sum == 0)
+            continue;
+
+        rows.push_back(v.idx.value);
+        for (auto const h : v.outgoing_halfedges())
+        {
+            neighbors.push_back(h.vertex_to().idx.value);
+            weights.push_back(edge_weight[h.edge()] / weight_sum);
+        }
+        offsets.push_back(int(neighbors.size()));
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+/// normalized Laplacian L(x)_i = sum_j w_ij (x_j - x_i) / sum_j w_ij of a mesh with fixed edge weights,
+/// precompiled in compressed sparse row layout so that smoothing is a plain sparse matrix-vector product
+/// there is one row per free vertex, locked vertices have no row (they never move, their Laplacian is zero)
+/// the neighbors of the i-th free vertex rows[i] are neighbors[offsets[i]] .. neighbors[offsets[i + 1] - 1]
+/// vectors passed to apply are indexed by vertex index (e.g. the data() of a vertex attribute)
+/// (the fields can also be filled directly, e.g. for the coarse levels of multigrid_solver, then "vertex index"
+/// is just the index into the vectors)
+struct laplacian_operator
+{
+    std::vector<int> rows;          ///< vertex index of every row
+    std::vector<int> offsets = {0}; ///< one entry per row plus one
+    std::vector<int> neighbors;     ///< vertex indices
+    std::vector<float> weights;     ///< w_ij / sum_j w_ij, one entry per neighbor
+    int num_vertices = 0;           ///< number of vertex indices covered (all_vertices, including removed ones)
+
+    laplacian_operator() = default;
+    laplacian_operator(pm::Mesh const& mesh, pm::edge_attribute<float> const& edge_weight, pm::vertex_attribute<bool> const& locked);
+
+    int num_rows() const { return int(rows.size()); }
+
+    /// L(in)_rows[r], the row kernel shared by all smoothers (the weighted differences are summed in neighbor order)
+    template <class T>
+    auto apply_row(T const* in, int r) const
+    {
+        auto const xi = in[rows[r]];
+        auto u = decltype(xi - xi)::zero;
+        for (auto k = offsets[r]; k < offsets[r + 1]; ++k)
+            u += weights[k] * (in[neighbors[k]] - xi);
+        return u;
+    }
+
+    /// out[rows[r]] = L(in)_rows[r] for r in [begin, end), other entries of out are not touched
+    template <class T>
+    void apply(T const* in, tg::vec3* out, int begin, int end) const
+    {
+        for (auto r = begin; r < end; ++r)
+            out[rows[r]] = apply_row(in, r);
+    }
+    template <class T>
+    void apply(T const* in, tg::vec3* out) const
+    {
+        apply(in, out, 0, num_rows());
+    }
+};
+}
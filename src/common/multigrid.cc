@@ -0,0 +1,596 @@
+#include "multigrid.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <polymesh/properties.hh>
+#include <typed-geometry/tg.hh>
+
+#include <common/laplacian_operator.hh>
+#include <common/parallel_chunks.hh>
+#include <common/trace.hh>
+
+namespace
+{
+// coarsening stops at this many unknowns, after max_levels or once a level removes less than a twentieth of them
+constexpr int coarsest_size = 256;
+constexpr int max_levels = 32;
+
+// the coarsest level is factorized (dense) up to this size, a stalled larger one is only smoothed
+constexpr int max_direct_size = 1024;
+constexpr int coarse_sweeps = 32;
+
+// pre- and post-smoothing steps per level and cycle
+constexpr int smoothing_steps = 2;
+constexpr float jacobi_damping = 2.0f / 3.0f;
+
+// weights of a coarse row below this are dropped (float precision of the row sums)
+constexpr double min_ground_weight = 1e-6;
+
+// both value types are solved in padded (x, y, z, 0) lanes
+tg::vec4 to_lanes(tg::pos3 const& p) { return {p.x, p.y, p.z, 0}; }
+tg::vec4 to_lanes(tg::pos2 const& p) { return {p.x, p.y, 0, 0}; }
+void from_lanes(tg::vec4 const& v, tg::pos3& p) { p = {v.x, v.y, v.z}; }
+void from_lanes(tg::vec4 const& v, tg::pos2& p) { p = {v.x, v.y}; }
+}
+
+struct gp::multigrid_solver::hierarchy
+{
+    /// A = D (I - W) of one level, W (-a_ij / a_ii) as a laplacian_operator whose rows are the unknowns, so that
+    /// A x = b is D (b / D + L(x)) and all smoothers share its row kernel
+    /// the vectors of level 0 are indexed by vertex index, the locked vertices hold the boundary values (its
+    /// right-hand side is zero), a coarse level with m unknowns has the indices 0 .. m - 1 plus a "ground" index m
+    /// that is always zero and takes the connections to the boundary, so the weights of every row sum to one
+    struct level
+    {
+        laplacian_operator op;
+        std::vector<float> diagonal; ///< a_ii, one per row
+
+        // transfer to the next coarser level (empty on the coarsest)
+        std::vector<int> coarse_of;              ///< per index, -1 if removed (interpolated with its own row)
+        std::vector<int> restrict_offsets = {0}; ///< per coarse unknown, the rows of P^T
+        std::vector<int> restrict_rows;          ///< indices: the surviving unknown itself, then its removed neighbors
+        std::vector<float> restrict_weights;     ///< 1, then the entries of the removed rows
+
+        int size() const { return op.num_rows(); }
+    };
+
+    /// per level (indexed as the level): solution, right-hand side and scratch space
+    struct workspace
+    {
+        std::vector<std::vector<tg::vec4>> x;
+        std::vector<std::vector<tg::vec4>> b;
+        std::vector<std::vector<tg::vec4>> tmp;
+        std::vector<std::vector<tg::vec4>> correction;
+    };
+
+    std::vector<level> levels;
+
+    std::vector<double> factor; ///< dense L D L^T of the coarsest level (row-major, D on the diagonal), empty if too large
+
+    void smooth(int l, workspace& ws, int steps, bool parallel) const;
+    void coarse_solve(workspace& ws, bool parallel) const;
+    void cycle(int l, workspace& ws, bool parallel) const;
+
+    template <class T>
+    convergence_info solve(pm::vertex_attribute<T>& x, stopping_rule const& rule, bool parallel) const;
+};
+
+gp::multigrid_solver::multigrid_solver() = default;
+gp::multigrid_solver::~multigrid_solver() = default;
+gp::multigrid_solver::multigrid_solver(multigrid_solver&&) noexcept = default;
+gp::multigrid_solver& gp::multigrid_solver::operator=(multigrid_solver&&) noexcept = default;
+
+gp::multigrid_solver::multigrid_solver(pm::vertex_attribute<tg::pos3> const& position,
+                                       pm::edge_attribute<float> const& edge_weight,
+                                       pm::vertex_attribute<bool> const& locked)
+  : _hierarchy(std::make_unique<hierarchy>())
+{
+    auto& hier = *_hierarchy;
+    auto const& mesh = position.mesh();
+    auto const n = mesh.all_vertices().size();
+
+    // unknowns are the free vertices with a nonzero weight sum, the rows of the smoothing operator
+    auto& finest = hier.levels.emplace_back();
+    finest.op = laplacian_operator(mesh, edge_weight, locked);
+    for (auto const i : finest.op.rows)
+    {
+        auto weight_sum = 0.0f;
+        for (auto const h : mesh.vertices()[pm::vertex_index(i)].outgoing_halfedges())
+            weight_sum += edge_weight[h.edge()];
+        finest.diagonal.push_back(weight_sum);
+    }
+
+    // row of every vertex on the current level, -1 if it is none (anymore)
+    std::vector<int> level_index(n, -1);
+    for (auto r = 0; r < finest.size(); ++r)
+        level_index[finest.op.rows[r]] = r;
+
+    // the decimated copy keeps the vertex indices, collapses do not move the surviving vertices
+    auto const coarse_mesh = mesh.copy();
+    auto pos = coarse_mesh->vertices().make_attribute<tg::pos3>();
+    std::copy(position.data(), position.data() + n, pos.data());
+
+    auto quadric = coarse_mesh->vertices().make_attribute<tg::quadric3>();
+    for (auto const f : coarse_mesh->faces())
+    {
+        auto const vs = f.vertices().to_array<3>();
+        auto const normal = tg::normalize_safe(tg::cross(pos[vs[1]] - pos[vs[0]], pos[vs[2]] - pos[vs[0]]));
+        for (auto const v : vs)
+            quadric[v].add_plane(pos[v], normal, 0);
+    }
+
+    // the error of collapsing v into a neighbor is the combined quadric at the neighbor
+    std::vector<std::pair<float, int>> options;
+    auto const collapse_options = [&](pm::vertex_handle v) {
+        options.clear();
+        for (auto const h : v.outgoing_halfedges())
+            options.emplace_back((quadric[v] + quadric[h.vertex_to()])(pos[h.vertex_to()]), h.idx.value);
+        std::sort(options.begin(), options.end());
+    };
+
+    // cheapest legal collapse of v, the legality is only tested until one passes
+    auto const best_collapse = [&](pm::vertex_handle v) {
+        collapse_options(v);
+        for (auto const& [error, h] : options)
+            if (auto const he = coarse_mesh->halfedges()[pm::halfedge_index(h)]; pm::can_collapse_without_flips(he, pos[he.vertex_to()], pos))
+                return he;
+        return pm::halfedge_handle();
+    };
+
+    auto level_vertices = finest.op.rows;
+    std::vector<std::pair<float, int>> candidates;
+    std::vector<bool> frozen;
+    std::vector<int> target;       ///< vertex index of the collapse target of every removed unknown
+    std::vector<int> coarse_index; ///< per row, -1 if removed
+    std::vector<int> row_of;       ///< per index of the fine level, -1 if it is not a row
+    std::vector<double> values;
+    std::vector<double> diagonal;
+    while (hier.levels.back().size() > coarsest_size && int(hier.levels.size()) < max_levels)
+    {
+        auto& fine = hier.levels.back();
+        auto const& op = fine.op;
+        auto const size = fine.size();
+        row_of.assign(op.num_vertices, -1);
+        for (auto r = 0; r < size; ++r)
+            row_of[op.rows[r]] = r;
+
+        // interior unknowns in order of their cheapest collapse (legal or not, it is checked when it is their turn)
+        candidates.clear();
+        for (auto i = 0; i < size; ++i)
+        {
+            auto const v = coarse_mesh->vertices()[pm::vertex_index(level_vertices[i])];
+            if (v.is_boundary())
+                continue;
+            collapse_options(v);
+            candidates.emplace_back(options.front().first, i);
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        // a collapse freezes the neighbors of the removed vertex, so its 1-ring is still the one of its row in fine
+        // and all of the ring survives the level (the collapse record is a row of P)
+        frozen.assign(size, false);
+        target.assign(size, -1);
+        coarse_index.assign(size, 0);
+        auto removed = 0;
+        for (auto const& [priority, i] : candidates)
+        {
+            if (frozen[i])
+                continue;
+
+            auto const v = coarse_mesh->vertices()[pm::vertex_index(level_vertices[i])];
+            auto const h = best_collapse(v);
+            if (h.is_invalid())
+                continue;
+
+            for (auto const w : v.adjacent_vertices())
+                if (auto const j = level_index[w.idx.value]; j >= 0)
+                    frozen[j] = true;
+            target[i] = h.vertex_to().idx.value;
+            quadric[h.vertex_to()].add(quadric[v]);
+            coarse_mesh->halfedges().collapse(h);
+            coarse_index[i] = -1;
+            ++removed;
+        }
+        if (removed == 0)
+            break;
+
+        std::vector<int> coarse_vertices;
+        for (auto i = 0; i < size; ++i)
+            if (coarse_index[i] >= 0)
+            {
+                coarse_index[i] = int(coarse_vertices.size());
+                coarse_vertices.push_back(level_vertices[i]);
+            }
+        auto const coarse_size = int(coarse_vertices.size());
+
+        // coarse row of the neighbor k of a fine row, -1 if removed, -2 if it is not a row (locked or the ground)
+        auto const coarse_neighbor = [&](int k) {
+            auto const j = row_of[op.neighbors[k]];
+            return j >= 0 ? coarse_index[j] : -2;
+        };
+
+        // Galerkin product P^T A P: the rows of the survivors plus, for every removed j, the clique
+        // -a_jj w_jp w_jq over its ring (the Schur complement of the independent removed vertices)
+        // the pattern are the edges of the decimated mesh, a clique entry between ring vertices p, q that are no longer
+        // adjacent is rerouted through the collapse target t, which is adjacent to both: the conductance c between p
+        // and q is replaced by 2c between p and t and between t and q, which keeps the row sums and the effective
+        // conductance and only makes the operator larger (simply lumping it makes it smaller, so the coarse
+        // corrections would overshoot)
+        hierarchy::level coarse;
+        for (auto p = 0; p < coarse_size; ++p)
+        {
+            for (auto const w : coarse_mesh->vertices()[pm::vertex_index(coarse_vertices[p])].adjacent_vertices())
+                if (auto const j = level_index[w.idx.value]; j >= 0)
+                    coarse.op.neighbors.push_back(coarse_index[j]);
+            coarse.op.offsets.push_back(int(coarse.op.neighbors.size()));
+        }
+        auto const& cn = coarse.op.neighbors;
+        auto const& co = coarse.op.offsets;
+        values.assign(cn.size(), 0.0);
+        diagonal.assign(coarse_size, 0.0);
+        auto const entry = [&](int p, int q) -> double& {
+            auto k = co[p];
+            while (cn[k] != q)
+                ++k;
+            return values[k];
+        };
+        auto const adjacent = [&](int p, int q) { return std::find(cn.begin() + co[p], cn.begin() + co[p + 1], q) != cn.begin() + co[p + 1]; };
+
+        for (auto i = 0; i < size; ++i)
+        {
+            auto const p = coarse_index[i];
+            if (p < 0)
+                continue;
+            diagonal[p] += fine.diagonal[i];
+            for (auto k = op.offsets[i]; k < op.offsets[i + 1]; ++k)
+                if (auto const q = coarse_neighbor(k); q >= 0)
+                    entry(p, q) -= double(op.weights[k]) * fine.diagonal[i];
+        }
+        for (auto j = 0; j < size; ++j)
+        {
+            if (coarse_index[j] >= 0)
+                continue;
+            auto const t_fine = level_index[target[j]];
+            auto const t = t_fine >= 0 ? coarse_index[t_fine] : -1; // -1: locked, its value is zero
+            // the ring of j survives, only the locked (or ground) neighbors are no unknowns
+            for (auto k = op.offsets[j]; k < op.offsets[j + 1]; ++k)
+                for (auto l = op.offsets[j]; l < op.offsets[j + 1]; ++l)
+                {
+                    auto const p = coarse_neighbor(k);
+                    auto const q = coarse_neighbor(l);
+                    if (p < 0 || q < 0)
+                        continue;
+                    auto const a = -double(fine.diagonal[j]) * op.weights[k] * op.weights[l];
+                    if (p == q)
+                        diagonal[p] += a;
+                    else if (adjacent(p, q))
+                        entry(p, q) += a;
+                    else
+                    {
+                        diagonal[p] -= a;
+                        if (t >= 0)
+                        {
+                            entry(p, t) += 2 * a;
+                            entry(t, q) += 2 * a;
+                            diagonal[t] -= 2 * a;
+                        }
+                    }
+                }
+        }
+
+        // normalized rows, the remainder of the row sum connects to the ground
+        laplacian_operator coarse_op;
+        coarse_op.num_vertices = coarse_size + 1;
+        for (auto p = 0; p < coarse_size; ++p)
+        {
+            auto ground = diagonal[p];
+            for (auto k = co[p]; k < co[p + 1]; ++k)
+            {
+                coarse_op.neighbors.push_back(cn[k]);
+                coarse_op.weights.push_back(float(-values[k] / diagonal[p]));
+                ground += values[k];
+            }
+            if (std::abs(ground) > min_ground_weight * diagonal[p])
+            {
+                coarse_op.neighbors.push_back(coarse_size);
+                coarse_op.weights.push_back(float(ground / diagonal[p]));
+            }
+            coarse_op.rows.push_back(p);
+            coarse_op.offsets.push_back(int(coarse_op.neighbors.size()));
+            coarse.diagonal.push_back(float(diagonal[p]));
+        }
+        coarse.op = std::move(coarse_op);
+
+        // the coarse index of every fine index, those that are no rows are zero like the coarse ground
+        fine.coarse_of.assign(op.num_vertices, coarse_size);
+        for (auto i = 0; i < size; ++i)
+            fine.coarse_of[op.rows[i]] = coarse_index[i];
+
+        // P^T in rows: every coarse unknown gathers itself and the removed vertices that interpolate from it
+        std::vector<int> count(coarse_size, 1);
+        for (auto j = 0; j < size; ++j)
+            if (coarse_index[j] < 0)
+                for (auto l = op.offsets[j]; l < op.offsets[j + 1]; ++l)
+                    if (auto const p = coarse_neighbor(l); p >= 0)
+                        ++count[p];
+        fine.restrict_offsets.resize(coarse_size + 1);
+        for (auto p = 0; p < coarse_size; ++p)
+            fine.restrict_offsets[p + 1] = fine.restrict_offsets[p] + count[p];
+        fine.restrict_rows.resize(fine.restrict_offsets.back());
+        fine.restrict_weights.resize(fine.restrict_offsets.back());
+        auto next = fine.restrict_offsets;
+        for (auto i = 0; i < size; ++i)
+            if (auto const p = coarse_index[i]; p >= 0)
+            {
+                fine.restrict_rows[next[p]] = op.rows[i];
+                fine.restrict_weights[next[p]++] = 1;
+            }
+        for (auto j = 0; j < size; ++j)
+            if (coarse_index[j] < 0)
+                for (auto l = op.offsets[j]; l < op.offsets[j + 1]; ++l)
+                    if (auto const p = coarse_neighbor(l); p >= 0)
+                    {
+                        fine.restrict_rows[next[p]] = op.rows[j];
+                        fine.restrict_weights[next[p]++] = op.weights[l];
+                    }
+
+        for (auto i = 0; i < size; ++i)
+            level_index[level_vertices[i]] = coarse_index[i];
+        level_vertices = std::move(coarse_vertices);
+
+        GP_TRACE(gp::trace::info, "[multigrid] level {}: {} unknowns, {} removed", int(hier.levels.size()), coarse_size, removed);
+        hier.levels.push_back(std::move(coarse));
+        if (removed * 20 < size)
+            break;
+    }
+
+    // dense L D L^T of the coarsest level, a vanishing pivot belongs to unknowns without any locked vertex
+    // in their component (A is singular there), the solve leaves them unchanged
+    auto const& coarsest = hier.levels.back();
+    auto const m = coarsest.size();
+    if (m <= max_direct_size)
+    {
+        row_of.assign(coarsest.op.num_vertices, -1);
+        for (auto r = 0; r < m; ++r)
+            row_of[coarsest.op.rows[r]] = r;
+
+        auto& a = hier.factor;
+        a.assign(size_t(m) * m, 0.0);
+        for (auto r = 0; r < m; ++r)
+        {
+            a[size_t(r) * m + r] = coarsest.diagonal[r];
+            for (auto k = coarsest.op.offsets[r]; k < coarsest.op.offsets[r + 1]; ++k)
+                if (auto const c = row_of[coarsest.op.neighbors[k]]; c >= 0)
+                    a[size_t(r) * m + c] = -double(coarsest.op.weights[k]) * coarsest.diagonal[r];
+        }
+
+        for (auto j = 0; j < m; ++j)
+        {
+            auto const row_j = a.data() + size_t(j) * m;
+            for (auto i = 0; i < j; ++i)
+            {
+                auto const row_i = a.data() + size_t(i) * m;
+                auto s = row_j[i];
+                for (auto k = 0; k < i; ++k)
+                    s -= row_j[k] * row_i[k] * a[size_t(k) * m + k];
+                row_j[i] = row_i[i] == 0 ? 0 : s / row_i[i];
+            }
+            auto d = row_j[j];
+            for (auto k = 0; k < j; ++k)
+                d -= row_j[k] * row_j[k] * a[size_t(k) * m + k];
+            row_j[j] = d > 1e-9 * coarsest.diagonal[j] ? d : 0;
+        }
+    }
+}
+
+bool gp::multigrid_solver::is_valid() const { return _hierarchy != nullptr; }
+
+int gp::multigrid_solver::num_levels() const { return _hierarchy ? int(_hierarchy->levels.size()) : 0; }
+
+int gp::multigrid_solver::num_unknowns(int level) const { return _hierarchy->levels[level].size(); }
+
+gp::convergence_info gp::multigrid_solver::solve(pm::vertex_attribute<tg::pos3>& x, stopping_rule const& rule, bool parallel) const
+{
+    return _hierarchy->solve(x, rule, parallel);
+}
+
+gp::convergence_info gp::multigrid_solver::solve(pm::vertex_attribute<tg::pos2>& x, stopping_rule const& rule, bool parallel) const
+{
+    return _hierarchy->solve(x, rule, parallel);
+}
+
+void gp::multigrid_solver::hierarchy::smooth(int l, workspace& ws, int steps, bool parallel) const
+{
+    // damped Jacobi on A x = b: x_i += omega (b_i / a_ii + L(x)_i)
+    auto const& lv = levels[l];
+    auto const rows = lv.op.rows.data();
+    auto const b = ws.b[l].data();
+    for (auto s = 0; s < steps; ++s)
+    {
+        auto const in = ws.x[l].data();
+        auto const out = ws.tmp[l].data();
+        run_chunks(lv.size(), parallel, [&](int begin, int end) {
+            for (auto r = begin; r < end; ++r)
+                out[rows[r]] = in[rows[r]] + jacobi_damping * (b[rows[r]] / lv.diagonal[r] + lv.op.apply_row(in, r));
+        });
+        std::swap(ws.x[l], ws.tmp[l]);
+    }
+}
+
+void gp::multigrid_solver::hierarchy::coarse_solve(workspace& ws, bool parallel) const
+{
+    auto const l = int(levels.size()) - 1;
+    if (factor.empty())
+    {
+        smooth(l, ws, coarse_sweeps, parallel);
+        return;
+    }
+
+    // solved for the correction of x with the residual as right-hand side, on level 0 (no coarsening) the boundary
+    // values are only in x, on the coarser ones x is zero
+    // forward substitution, diagonal, backward substitution
+    auto const& lv = levels[l];
+    auto const rows = lv.op.rows.data();
+    auto const m = lv.size();
+    std::vector<tg::dvec4> y(m);
+    for (auto i = 0; i < m; ++i)
+    {
+        auto const row = factor.data() + size_t(i) * m;
+        auto s = tg::dvec4(ws.b[l][rows[i]] + lv.diagonal[i] * lv.op.apply_row(ws.x[l].data(), i));
+        for (auto k = 0; k < i; ++k)
+            s -= row[k] * y[k];
+        y[i] = s;
+    }
+    for (auto i = 0; i < m; ++i)
+    {
+        auto const d = factor[size_t(i) * m + i];
+        y[i] = d == 0 ? tg::dvec4::zero : y[i] / d;
+    }
+    for (auto i = m - 1; i >= 0; --i)
+    {
+        auto const yi = y[i];
+        auto const row = factor.data() + size_t(i) * m;
+        for (auto k = 0; k < i; ++k)
+            y[k] -= row[k] * yi;
+    }
+    for (auto i = 0; i < m; ++i)
+        ws.x[l][rows[i]] += tg::vec4(y[i]);
+}
+
+void gp::multigrid_solver::hierarchy::cycle(int l, workspace& ws, bool parallel) const
+{
+    if (l + 1 == int(levels.size()))
+    {
+        coarse_solve(ws, parallel);
+        return;
+    }
+
+    auto const& lv = levels[l];
+    auto const rows = lv.op.rows.data();
+    smooth(l, ws, smoothing_steps, parallel);
+
+    // residual r = b - A x (in tmp), restricted to the right-hand side of the coarse correction
+    auto const x = ws.x[l].data();
+    auto const b = ws.b[l].data();
+    auto const r = ws.tmp[l].data();
+    run_chunks(lv.size(), parallel, [&](int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            r[rows[i]] = b[rows[i]] + lv.diagonal[i] * lv.op.apply_row(x, i);
+    });
+
+    auto const coarse_b = ws.b[l + 1].data();
+    run_chunks(levels[l + 1].size(), parallel, [&](int begin, int end) {
+        for (auto p = begin; p < end; ++p)
+        {
+            auto s = tg::vec4::zero;
+            for (auto k = lv.restrict_offsets[p]; k < lv.restrict_offsets[p + 1]; ++k)
+                s += lv.restrict_weights[k] * r[lv.restrict_rows[k]];
+            coarse_b[p] = s;
+        }
+    });
+    std::fill(ws.x[l + 1].begin(), ws.x[l + 1].end(), tg::vec4::zero);
+
+    cycle(l + 1, ws, parallel);
+
+    // prolongation: survivors take their correction, removed vertices interpolate it with their row
+    // (the entries that are no rows stay zero, as do their coarse indices)
+    auto const coarse_x = ws.x[l + 1].data();
+    auto const c = ws.correction[l].data();
+    run_chunks(lv.size(), parallel, [&](int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            if (auto const p = lv.coarse_of[rows[i]]; p >= 0)
+            {
+                c[rows[i]] = coarse_x[p];
+                continue;
+            }
+            auto u = tg::vec4::zero;
+            for (auto k = lv.op.offsets[i]; k < lv.op.offsets[i + 1]; ++k)
+                u += lv.op.weights[k] * coarse_x[lv.coarse_of[lv.op.neighbors[k]]];
+            c[rows[i]] = u;
+        }
+    });
+
+    // the coarse operators are stiffer than P^T A P, so the correction is scaled (per lane) to minimize the energy
+    // along it: alpha = <c, r> / <c, A c>
+    std::vector<tg::dvec4> num(num_chunks(lv.size()));
+    std::vector<tg::dvec4> den(num.size());
+    run_chunks(lv.size(), parallel, [&](int begin, int end) {
+        auto n = tg::dvec4::zero;
+        auto d = tg::dvec4::zero;
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const ci = c[rows[i]];
+            auto const ac = -lv.diagonal[i] * lv.op.apply_row(c, i);
+            n += tg::dvec4(tg::comp4(ci) * tg::comp4(r[rows[i]]));
+            d += tg::dvec4(tg::comp4(ci) * tg::comp4(ac));
+        }
+        num[begin / row_chunk_size] = n;
+        den[begin / row_chunk_size] = d;
+    });
+    auto n = tg::dvec4::zero;
+    auto d = tg::dvec4::zero;
+    for (auto k = 0u; k < num.size(); ++k)
+    {
+        n += num[k];
+        d += den[k];
+    }
+    tg::vec4 alpha;
+    for (auto k = 0; k < 4; ++k)
+        alpha[k] = d[k] > 0 ? tg::clamp(float(n[k] / d[k]), 0.0f, 2.0f) : 1.0f;
+
+    run_chunks(lv.size(), parallel, [&](int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            x[rows[i]] += tg::vec4(tg::comp4(alpha) * tg::comp4(c[rows[i]]));
+    });
+
+    smooth(l, ws, smoothing_steps, parallel);
+}
+
+template <class T>
+gp::convergence_info gp::multigrid_solver::hierarchy::solve(pm::vertex_attribute<T>& x, stopping_rule const& rule, bool parallel) const
+{
+    workspace ws;
+    for (auto const& lv : levels)
+    {
+        ws.x.emplace_back(lv.op.num_vertices);
+        ws.b.emplace_back(lv.op.num_vertices);
+        ws.tmp.emplace_back(lv.op.num_vertices);
+        ws.correction.emplace_back(lv.op.num_vertices);
+    }
+
+    // level 0 holds all vertices, the locked ones are never written and keep their values in both buffers
+    auto const data = x.data();
+    for (auto i = 0; i < levels[0].op.num_vertices; ++i)
+        ws.x[0][i] = to_lanes(data[i]);
+    ws.tmp[0] = ws.x[0];
+
+    // the displacement of a cycle is accumulated per chunk and merged in order, as for the smoothing kernels
+    auto const rows = levels[0].op.rows.data();
+    std::vector<tg::vec4> previous;
+    convergence_info info;
+    while (info.iterations < rule.max_iterations && !info.converged)
+    {
+        previous = ws.x[0];
+        cycle(0, ws, parallel);
+
+        auto const residual = for_chunks(levels[0].size(), parallel, [&](int begin, int end, residual_accumulator& res) {
+            for (auto i = begin; i < end; ++i)
+            {
+                auto const d = ws.x[0][rows[i]] - previous[rows[i]];
+                res.add(tg::dot(d, d));
+            }
+        });
+
+        ++info.iterations;
+        info.residual = residual.residual(rule.residual_norm);
+        info.converged = info.residual <= rule.tolerance;
+    }
+
+    for (auto i = 0; i < levels[0].size(); ++i)
+        from_lanes(ws.x[0][rows[i]], data[rows[i]]);
+    return info;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+
+#include <polymesh/Mesh.hh>
+#include <typed-geometry/tg-lean.hh>
+
+#include <common/convergence.hh>
+
+namespace gp
+{
+/// multigrid solver for the harmonic problem sum_j w_ij (x_j - x_i) = 0 at every free vertex i, with the locked
+/// vertices as boundary values: the steady state of Jacobi / Gauss-Seidel Laplacian smoothing and of the
+/// texture coordinate relaxation, reached in a number of cycles that hardly depends on the mesh size
+///
+/// the hierarchy comes from quadric-driven halfedge collapses of a copy of the mesh (as in task::decimate),
+/// within one level the neighbors of a removed vertex are frozen, so the removed vertices are independent and the
+/// collapse record (the removed vertex and its 1-ring) is its prolongation: the vertex is interpolated from its
+/// neighbors with its own operator row, which is exact for a harmonic error
+/// the coarse operator is the Galerkin product P^T A P on the edges of the decimated mesh, connections between
+/// vertices that are no longer adjacent are rerouted through the collapse target, which makes it slightly stiffer,
+/// so every coarse correction is scaled by the step length that minimizes the energy along it
+///
+/// every level is a laplacian_operator (level 0 the one of the Laplacian smoothers, with the boundary values in the
+/// locked entries), every V-cycle runs damped Jacobi pre- and post-smoothing with its row kernel on all levels and
+/// solves the coarsest one directly
+/// the hierarchy only depends on the mesh, the weights and the locked vertices, so like implicit_smoother
+/// it is meant to be kept and reused until one of them changes
+/// NOTE: the weights have to be symmetric (one per edge), as for the cotangent and uniform Laplacians
+struct multigrid_solver
+{
+    multigrid_solver();
+    multigrid_solver(pm::vertex_attribute<tg::pos3> const& position,
+                     pm::edge_attribute<float> const& edge_weight,
+                     pm::vertex_attribute<bool> const& locked);
+    ~multigrid_solver();
+
+    multigrid_solver(multigrid_solver&&) noexcept;
+    multigrid_solver& operator=(multigrid_solver&&) noexcept;
+
+    /// false if not built
+    bool is_valid() const;
+
+    int num_levels() const;
+    /// free vertices of a level, level 0 is the input mesh
+    int num_unknowns(int level) const;
+
+    /// one V-cycle per iteration of the rule, the residual is the displacement of the free vertices in a cycle,
+    /// which levels off at the float precision of x
+    /// the locked entries of x are the boundary values, the free ones the initial guess
+    convergence_info solve(pm::vertex_attribute<tg::pos3>& x, stopping_rule const& rule, bool parallel = true) const;
+    convergence_info solve(pm::vertex_attribute<tg::pos2>& x, stopping_rule const& rule, bool parallel = true) const;
+
+private:
+    struct hierarchy;
+    std::unique_ptr<hierarchy> _hierarchy;
+};
+}
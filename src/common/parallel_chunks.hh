@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <common/convergence.hh>
+#include <common/thread_pool.hh>
+
+namespace gp
+{
+/// rows per chunk of the sparse kernels, large enough to amortize the scheduling and small enough to balance
+constexpr int row_chunk_size = 2048;
+
+inline int num_chunks(int n) { return (n + row_chunk_size - 1) / row_chunk_size; }
+
+/// calls f(begin, end) for the chunks of [0, n), on the global thread pool or serially (in order)
+/// chunk c always starts at c * row_chunk_size, so per-chunk results can be indexed by begin / row_chunk_size
+template <class F>
+void run_chunks(int n, bool parallel, F&& f)
+{
+    if (parallel)
+        thread_pool::global().parallel_for(n, row_chunk_size, f);
+    else
+        for (auto begin = 0; begin < n; begin += row_chunk_size)
+            f(begin, std::min(n, begin + row_chunk_size));
+}
+
+/// merges per-chunk residuals in order, so the result does not depend on the scheduling
+inline residual_accumulator merge_residuals(std::vector<residual_accumulator> const& partial)
+{
+    residual_accumulator total;
+    for (auto const& p : partial)
+        total.merge(p);
+    return total;
+}
+
+/// calls f(begin, end, residual) for the chunks of [0, n) with one residual_accumulator per chunk and merges them
+template <class F>
+residual_accumulator for_chunks(int n, bool parallel, F&& f)
+{
+    std::vector<residual_accumulator> partial(num_chunks(n));
+    run_chunks(n, parallel, [&](int begin, int end) { f(begin, end, partial[begin / row_chunk_size]); });
+    return merge_residuals(partial);
+}
+}
@@ -0,0 +1,238 @@
+#include "predicates.hh"
+
+#include <cmath>
+#include <vector>
+
+#include <typed-geometry/tg.hh>
+
+namespace
+{
+constexpr double epsilon = 1.0 / 9007199254740992.0; // 2^-53, half an ulp of 1
+
+// relative error bounds of the double precision evaluations (Shewchuk, error bounds "A")
+constexpr double orient2d_bound = (3.0 + 16.0 * epsilon) * epsilon;
+constexpr double incircle_bound = (10.0 + 96.0 * epsilon) * epsilon;
+constexpr double orient3d_bound = (7.0 + 56.0 * epsilon) * epsilon;
+
+int sign(double x) { return (x > 0) - (x < 0); }
+
+// exact value as an unevaluated sum of non-overlapping doubles, sorted by increasing magnitude, zeros removed
+// only used in the rare cases where the filter fails, so simplicity beats speed here
+using expansion = std::vector<double>;
+
+// x + y == a + b exactly, x = fl(a + b)
+void two_sum(double a, double b, double& x, double& y)
+{
+    x = a + b;
+    auto const b_virtual = x - a;
+    auto const a_virtual = x - b_virtual;
+    y = (a - a_virtual) + (b - b_virtual);
+}
+
+// same as two_sum, requires |a| >= |b|
+void fast_two_sum(double a, double b, double& x, double& y)
+{
+    x = a + b;
+    y = b - (x - a);
+}
+
+// x + y == a * b exactly, x = fl(a * b)
+void two_product(double a, double b, double& x, double& y)
+{
+    x = a * b;
+    y = std::fma(a, b, -x);
+}
+
+expansion difference(double a, double b)
+{
+    double x, y;
+    two_sum(a, -b, x, y);
+    if (y == 0)
+        return {x};
+    return {y, x};
+}
+
+// e + b
+expansion grow(expansion const& e, double b)
+{
+    expansion h;
+    h.reserve(e.size() + 1);
+    auto q = b;
+    for (auto const c : e)
+    {
+        double sum, err;
+        two_sum(q, c, sum, err);
+        q = sum;
+        if (err != 0)
+            h.push_back(err);
+    }
+    if (q != 0 || h.empty())
+        h.push_back(q);
+    return h;
+}
+
+// e + f
+expansion sum(expansion e, expansion const& f)
+{
+    for (auto const c : f)
+        e = grow(e, c);
+    return e;
+}
+
+// e * b
+expansion scale(expansion const& e, double b)
+{
+    expansion h;
+    h.reserve(2 * e.size());
+
+    double q, err;
+    two_product(e[0], b, q, err);
+    if (err != 0)
+        h.push_back(err);
+    for (auto i = 1u; i < e.size(); ++i)
+    {
+        double product_hi, product_lo, s;
+        two_product(e[i], b, product_hi, product_lo);
+        two_sum(q, product_lo, s, err);
+        if (err != 0)
+            h.push_back(err);
+        fast_two_sum(product_hi, s, q, err);
+        if (err != 0)
+            h.push_back(err);
+    }
+    if (q != 0 || h.empty())
+        h.push_back(q);
+    return h;
+}
+
+// e * f
+expansion product(expansion const& e, expansion const& f)
+{
+    expansion h = {0.0};
+    for (auto const c : f)
+        h = sum(std::move(h), scale(e, c));
+    return h;
+}
+
+expansion negate(expansion e)
+{
+    for (auto& c : e)
+        c = -c;
+    return e;
+}
+
+// the largest component determines the sign
+int sign(expansion const& e) { return sign(e.back()); }
+
+// a * d - b * c
+expansion cross(expansion const& a, expansion const& b, expansion const& c, expansion const& d)
+{
+    return sum(product(a, d), negate(product(b, c)));
+}
+}
+
+int gp::orient2d(tg::dpos2 const& a, tg::dpos2 const& b, tg::dpos2 const& c)
+{
+    auto const det_left = (a.x - c.x) * (b.y - c.y);
+    auto const det_right = (a.y - c.y) * (b.x - c.x);
+    auto const det = det_left - det_right;
+
+    // terms of different sign cannot cancel
+    if ((det_left > 0 && det_right <= 0) || (det_left < 0 && det_right >= 0) || det_left == 0)
+        return sign(det);
+
+    if (tg::abs(det) >= orient2d_bound * (tg::abs(det_left) + tg::abs(det_right)))
+        return sign(det);
+
+    auto const acx = difference(a.x, c.x);
+    auto const acy = difference(a.y, c.y);
+    auto const bcx = difference(b.x, c.x);
+    auto const bcy = difference(b.y, c.y);
+    return sign(cross(acx, acy, bcx, bcy));
+}
+
+int gp::incircle(tg::dpos2 const& a, tg::dpos2 const& b, tg::dpos2 const& c, tg::dpos2 const& d)
+{
+    auto const adx = a.x - d.x;
+    auto const ady = a.y - d.y;
+    auto const bdx = b.x - d.x;
+    auto const bdy = b.y - d.y;
+    auto const cdx = c.x - d.x;
+    auto const cdy = c.y - d.y;
+
+    auto const bdxcdy = bdx * cdy;
+    auto const cdxbdy = cdx * bdy;
+    auto const cdxady = cdx * ady;
+    auto const adxcdy = adx * cdy;
+    auto const adxbdy = adx * bdy;
+    auto const bdxady = bdx * ady;
+
+    auto const alift = adx * adx + ady * ady;
+    auto const blift = bdx * bdx + bdy * bdy;
+    auto const clift = cdx * cdx + cdy * cdy;
+
+    auto const det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+    auto const permanent = (tg::abs(bdxcdy) + tg::abs(cdxbdy)) * alift //
+                           + (tg::abs(cdxady) + tg::abs(adxcdy)) * blift
+                           + (tg::abs(adxbdy) + tg::abs(bdxady)) * clift;
+    if (tg::abs(det) > incircle_bound * permanent)
+        return sign(det);
+
+    auto const eadx = difference(a.x, d.x);
+    auto const eady = difference(a.y, d.y);
+    auto const ebdx = difference(b.x, d.x);
+    auto const ebdy = difference(b.y, d.y);
+    auto const ecdx = difference(c.x, d.x);
+    auto const ecdy = difference(c.y, d.y);
+
+    auto const ealift = sum(product(eadx, eadx), product(eady, eady));
+    auto const eblift = sum(product(ebdx, ebdx), product(ebdy, ebdy));
+    auto const eclift = sum(product(ecdx, ecdx), product(ecdy, ecdy));
+
+    auto const ebc = cross(ebdx, ecdx, ebdy, ecdy); // bdx * cdy - cdx * bdy
+    auto const eca = cross(ecdx, eadx, ecdy, eady); // cdx * ady - adx * cdy
+    auto const eab = cross(eadx, ebdx, eady, ebdy); // adx * bdy - bdx * ady
+    return sign(sum(sum(product(ealift, ebc), product(eblift, eca)), product(eclift, eab)));
+}
+
+int gp::orient3d(tg::dpos3 const& a, tg::dpos3 const& b, tg::dpos3 const& c, tg::dpos3 const& d)
+{
+    auto const adx = a.x - d.x;
+    auto const ady = a.y - d.y;
+    auto const adz = a.z - d.z;
+    auto const bdx = b.x - d.x;
+    auto const bdy = b.y - d.y;
+    auto const bdz = b.z - d.z;
+    auto const cdx = c.x - d.x;
+    auto const cdy = c.y - d.y;
+    auto const cdz = c.z - d.z;
+
+    auto const bdxcdy = bdx * cdy;
+    auto const cdxbdy = cdx * bdy;
+    auto const cdxady = cdx * ady;
+    auto const adxcdy = adx * cdy;
+    auto const adxbdy = adx * bdy;
+    auto const bdxady = bdx * ady;
+
+    auto const det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+    auto const permanent = (tg::abs(bdxcdy) + tg::abs(cdxbdy)) * tg::abs(adz) //
+                           + (tg::abs(cdxady) + tg::abs(adxcdy)) * tg::abs(bdz)
+                           + (tg::abs(adxbdy) + tg::abs(bdxady)) * tg::abs(cdz);
+    if (tg::abs(det) > orient3d_bound * permanent)
+        return sign(det);
+
+    auto const eadx = difference(a.x, d.x);
+    auto const eady = difference(a.y, d.y);
+    auto const eadz = difference(a.z, d.z);
+    auto const ebdx = difference(b.x, d.x);
+    auto const ebdy = difference(b.y, d.y);
+    auto const ebdz = difference(b.z, d.z);
+    auto const ecdx = difference(c.x, d.x);
+    auto const ecdy = difference(c.y, d.y);
+    auto const ecdz = difference(c.z, d.z);
+
+    auto const ebc = cross(ebdx, ecdx, ebdy, ecdy);
+    auto const eca = cross(ecdx, eadx, ecdy, eady);
+    auto const eab = cross(eadx, ebdx, eady, ebdy);
+    return sign(sum(sum(product(eadz, ebc), product(ebdz, eca)), product(ecdz, eab)));
+}
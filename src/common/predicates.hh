@@ -0,0 +1,32 @@
+#pragma once
+
+#include <typed-geometry/tg-lean.hh>
+
+namespace gp
+{
+// Adaptive-precision geometric predicates (J. Shewchuk, "Adaptive Precision Floating-Point Arithmetic and
+// Fast Robust Geometric Predicates"): the determinant is evaluated in double precision first and only
+// recomputed exactly with floating-point expansions if its sign is not certain.
+// All predicates return the exact sign of the determinant: 1, -1 or 0.
+
+/// 1 if a, b, c are in counter-clockwise order, -1 if clockwise, 0 if collinear
+int orient2d(tg::dpos2 const& a, tg::dpos2 const& b, tg::dpos2 const& c);
+
+/// 1 if d lies inside the circle through the counter-clockwise points a, b, c, -1 if outside, 0 if cocircular
+int incircle(tg::dpos2 const& a, tg::dpos2 const& b, tg::dpos2 const& c, tg::dpos2 const& d);
+
+/// 1 if d lies below the plane through a, b, c (a, b, c appear counter-clockwise when seen from above),
+/// -1 if above, 0 if coplanar; this is the sign of det(a - d, b - d, c - d)
+int orient3d(tg::dpos3 const& a, tg::dpos3 const& b, tg::dpos3 const& c, tg::dpos3 const& d);
+
+// float positions convert to double without rounding
+inline int orient2d(tg::pos2 const& a, tg::pos2 const& b, tg::pos2 const& c) { return orient2d(tg::dpos2(a), tg::dpos2(b), tg::dpos2(c)); }
+inline int incircle(tg::pos2 const& a, tg::pos2 const& b, tg::pos2 const& c, tg::pos2 const& d)
+{
+    return incircle(tg::dpos2(a), tg::dpos2(b), tg::dpos2(c), tg::dpos2(d));
+}
+inline int orient3d(tg::pos3 const& a, tg::pos3 const& b, tg::pos3 const& c, tg::pos3 const& d)
+{
+    return orient3d(tg::dpos3(a), tg::dpos3(b), tg::dpos3(c), tg::dpos3(d));
+}
+}
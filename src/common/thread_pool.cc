@@ -0,0 +1,98 @@
+#include "thread_pool.hh"
+
+gp::thread_pool::thread_pool(int num_threads)
+{
+    if (num_threads <= 0)
+        num_threads = int(std::thread::hardware_concurrency());
+
+    for (auto i = 1; i < num_threads; ++i)
+        _workers.emplace_back([this] { worker_loop(); });
+}
+
+gp::thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cv_start.notify_all();
+
+    for (auto& t : _workers)
+        t.join();
+}
+
+gp::thread_pool& gp::thread_pool::global()
+{
+    static thread_pool pool;
+    return pool;
+}
+
+void gp::thread_pool::parallel_for(int n, int chunk_size, std::function<void(int, int)> const& f)
+{
+    if (n <= 0)
+        return;
+
+    chunk_size = chunk_size < 1 ? 1 : chunk_size;
+
+    // not worth waking anyone up
+    if (_workers.empty() || n <= chunk_size)
+    {
+        for (auto begin = 0; begin < n; begin += chunk_size)
+            f(begin, begin + chunk_size < n ? begin + chunk_size : n);
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(_run_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = &f;
+        _job_size = n;
+        _chunk_size = chunk_size;
+        _next_chunk = 0;
+        _busy_workers = int(_workers.size());
+        ++_generation;
+    }
+    _cv_start.notify_all();
+
+    process_chunks();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv_done.wait(lock, [this] { return _busy_workers == 0; });
+    _job = nullptr;
+}
+
+void gp::thread_pool::process_chunks()
+{
+    while (true)
+    {
+        auto const begin = _next_chunk.fetch_add(1) * _chunk_size;
+        if (begin >= _job_size)
+            return;
+
+        (*_job)(begin, begin + _chunk_size < _job_size ? begin + _chunk_size : _job_size);
+    }
+}
+
+void gp::thread_pool::worker_loop()
+{
+    auto generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv_start.wait(lock, [&] { return _stop || _generation != generation; });
+            if (_stop)
+                return;
+            generation = _generation;
+        }
+
+        process_chunks();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (--_busy_workers == 0)
+                _cv_done.notify_one();
+        }
+    }
+}
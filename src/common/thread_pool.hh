@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gp
+{
+/// persistent pool of worker threads for data-parallel loops
+/// NOTE: parallel_for must not be called from within a job of the same pool
+struct thread_pool
+{
+    /// num_threads includes the calling thread, 0 means one per hardware thread
+    explicit thread_pool(int num_threads = 0);
+    ~thread_pool();
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+
+    int num_threads() const { return int(_workers.size()) + 1; }
+
+    /// calls f(begin, end) for disjoint chunks of at most chunk_size elements covering [0, n)
+    /// the calling thread participates, returns when all chunks are processed
+    void parallel_for(int n, int chunk_size, std::function<void(int, int)> const& f);
+
+    /// pool shared by all kernels of an application
+    static thread_pool& global();
+
+private:
+    void worker_loop();
+    void process_chunks();
+
+    std::vector<std::thread> _workers;
+
+    std::mutex _run_mutex; ///< serializes parallel_for calls
+    std::mutex _mutex;     ///< protects the job state below
+    std::condition_variable _cv_start;
+    std::condition_variable _cv_done;
+
+    std::function<void(int, int)> const* _job = nullptr;
+    int _job_size = 0;
+    int _chunk_size = 1;
+    std::atomic<int> _next_chunk{0};
+    int _generation = 0; ///< incremented for every job
+    int _busy_workers = 0;
+    bool _stop = false;
+};
+}
@@ -0,0 +1,116 @@
+#include "trace.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include <clean-core/experimental/ringbuffer.hh>
+
+namespace
+{
+struct thread_buffer
+{
+    int thread_id;
+    cc::ringbuffer<gp::trace::event> events;
+};
+
+// every thread registers its buffer once, the registry keeps it alive after the thread exits
+struct registry
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<thread_buffer>> buffers;
+
+    static registry& get()
+    {
+        static registry r;
+        return r;
+    }
+};
+
+thread_buffer& local_buffer()
+{
+    thread_local std::shared_ptr<thread_buffer> buffer = [] {
+        auto b = std::make_shared<thread_buffer>();
+        auto& r = registry::get();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        b->thread_id = int(r.buffers.size());
+        r.buffers.push_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+std::int64_t now_ns()
+{
+    static auto const start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+char const* level_name(int level)
+{
+    switch (level)
+    {
+    case gp::trace::info:
+        return "info";
+    case gp::trace::debug:
+        return "debug";
+    default:
+        return "verbose";
+    }
+}
+}
+
+void gp::trace::record(event const& e)
+{
+    auto& events = local_buffer().events;
+    if (int(events.size()) >= buffer_capacity)
+        events.pop_front();
+
+    auto& stored = events.push_back(e);
+    stored.time_ns = now_ns();
+}
+
+void gp::trace::dump(std::ostream& out)
+{
+    struct entry
+    {
+        event e;
+        int thread_id;
+    };
+    std::vector<entry> entries;
+
+    {
+        auto& r = registry::get();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (auto const& b : r.buffers)
+        {
+            while (!b->events.empty())
+                entries.push_back({b->events.pop_front(), b->thread_id});
+        }
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), [](entry const& a, entry const& b) { return a.e.time_ns < b.e.time_ns; });
+
+    for (auto const& en : entries)
+    {
+        out << "[" << double(en.e.time_ns) * 1e-3 << " us] [thread " << en.thread_id << "] [" << level_name(en.e.level) << "] ";
+
+        // replace "{}" by the arguments in order
+        auto arg = 0;
+        for (auto f = en.e.format; *f; ++f)
+        {
+            if (f[0] == '{' && f[1] == '}' && arg < en.e.num_args)
+            {
+                out << en.e.args[arg++];
+                ++f;
+            }
+            else
+                out << *f;
+        }
+        out << '\n';
+    }
+    out.flush();
+}
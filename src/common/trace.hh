@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <type_traits>
+
+// trace level compiled into the binary (see GP2_TRACE_LEVEL in the top-level CMakeLists.txt)
+// traces above it compile to nothing, including the evaluation of their arguments
+#ifndef GP_TRACE_LEVEL
+#define GP_TRACE_LEVEL 0
+#endif
+
+/// records an event in the trace buffer of the calling thread, e.g.
+///   GP_TRACE(gp::trace::debug, "flipped edge {} ({} flips so far)", e.idx.value, flips);
+/// the format must be a string literal, "{}" is replaced by the arguments (at most 6 numbers) when dumping
+#define GP_TRACE(level, ...)                               \
+    do                                                     \
+    {                                                      \
+        if constexpr (int(level) <= GP_TRACE_LEVEL)        \
+            ::gp::trace::record(int(level), __VA_ARGS__); \
+    } while (0)
+
+namespace gp::trace
+{
+constexpr int info = 1;    ///< a few events per operation
+constexpr int debug = 2;   ///< per primitive of an operation
+constexpr int verbose = 3; ///< everything
+
+constexpr int max_args = 6;
+
+/// events per thread, older ones are overwritten
+constexpr int buffer_capacity = 1 << 14;
+
+struct event
+{
+    std::int64_t time_ns;
+    char const* format;
+    double args[max_args];
+    int num_args;
+    int level;
+};
+
+/// appends an event to the ring buffer of the calling thread (no locks, no allocation once the buffer is full)
+void record(event const& e);
+
+template <class... Args>
+void record(int level, char const* format, Args... args)
+{
+    static_assert(sizeof...(Args) <= max_args, "too many trace arguments");
+    static_assert((std::is_arithmetic_v<Args> && ...), "trace arguments must be numbers");
+
+    double const values[] = {double(args)..., 0.0};
+
+    event e;
+    e.time_ns = 0; // set by record
+    e.format = format;
+    e.num_args = int(sizeof...(Args));
+    e.level = level;
+    for (auto i = 0; i < e.num_args; ++i)
+        e.args[i] = values[i];
+    record(e);
+}
+
+/// writes the events of all threads ordered by time and empties the buffers
+/// NOTE: must not run concurrently with traced code, call it between operations
+void dump(std::ostream& out);
+}